@@ -0,0 +1,237 @@
+#include "Looper.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+
+#include <thread>
+
+//written by cmake/bench_revision.cmake when the checkout changes
+#include "bench_revision.h"
+#ifndef LOOP_BENCH_REVISION
+#define LOOP_BENCH_REVISION "unknown"
+#endif
+
+// hot path benchmarks of Looper. Prints a table and writes every number as one
+// json record, so results of two commits can be diffed.
+//   bench_looper [--quick] [--json path]
+// exits non-zero when a benchmark lost work, so ctest can run it as a smoke test.
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+class TickRecorder : public Loop {
+public:
+    void update(int64_t dtUs)
+    {
+        ticks.push_back(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+    std::vector<int64_t> ticks;
+};
+
+struct BenchRecord {
+    std::string bench;
+    std::string param;
+    std::string metric;
+    double value;
+    std::string unit;
+};
+
+static std::vector<BenchRecord> records;
+static bool quick = false;
+static int failures = 0;   //lost work, a mode that never ticked, an unwritable json
+
+static void report(const std::string &bench, const std::string &param, const std::string &metric, double value, const std::string &unit)
+{
+    records.push_back({ bench, param, metric, value, unit });
+    std::cout << bench << "\t" << param << "\t" << metric << "\t" << value << " " << unit << std::endl;
+}
+
+static void reportHistogram(const std::string &bench, const std::string &param, const HistogramSnapshot &h)
+{
+    report(bench, param, "p50", h.percentile(0.5) / 1000.0, "us");
+    report(bench, param, "p99", h.percentile(0.99) / 1000.0, "us");
+    report(bench, param, "p99.9", h.percentile(0.999) / 1000.0, "us");
+    report(bench, param, "max", h.max / 1000.0, "us");
+}
+
+static Looper<int64_t>::Ptr startLooper(Loop *loop)
+{
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, loop, 1000);
+    looper->run();
+    return looper;
+}
+
+static void stopLooper(Looper<int64_t>::Ptr &looper)
+{
+    looper->syncStop();
+    looper->join();
+    looper.reset();
+}
+
+static const EventId BENCH_EVENT = EventId::of("bench");
+
+static void emitThroughput()
+{
+    const int64_t total = quick ? 200000 : 2000000;
+    for (int producers = 1; producers <= 8; producers *= 2) {
+        IdleLoop loop;
+        auto looper = startLooper(&loop);
+        int64_t *sum = new int64_t(0);
+        looper->on(BENCH_EVENT, [sum](int64_t &v) { *sum += v; });
+        const int64_t perThread = total / producers;
+
+        auto start = steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < producers; i++) {
+            threads.emplace_back([looper, perThread]() {
+                for (int64_t j = 0; j < perThread; j++) looper->emit(BENCH_EVENT, (int64_t)1);
+            });
+        }
+        for (auto &t : threads) t.join();
+        looper->wait([]() {});
+        double us = (double)duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0;
+
+        if (*sum != perThread * producers) {
+            std::cerr << "emit: lost events " << *sum << " / " << perThread * producers << std::endl;
+            failures += 1;
+        }
+        report("emit_throughput", "producers=" + std::to_string(producers), "rate", perThread * producers / us, "Mevents/s");
+        stopLooper(looper);
+        delete sum;
+    }
+}
+
+static void dispatchRoundTrip()
+{
+    const int rounds = quick ? 2000 : 20000;
+    IdleLoop loop;
+    auto looper = startLooper(&loop);
+    LatencyHistogram hist;
+    for (int i = 0; i < rounds; i++) {
+        int64_t start = metricsNowNs();
+        looper->submit([]() {}).wait();
+        hist.record((uint64_t)(metricsNowNs() - start));
+    }
+    reportHistogram("dispatch_round_trip", "submit+wait", hist.snapshot());
+    stopLooper(looper);
+}
+
+static void waitCost()
+{
+    const int rounds = quick ? 2000 : 20000;
+    IdleLoop loop;
+    auto looper = startLooper(&loop);
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < rounds; i++) looper->wait([]() {});
+    double ns = (double)duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    report("wait_cost", "other_thread", "mean", ns / rounds / 1000.0, "us");
+
+    double inlineNs = 0;
+    looper->wait([&looper, &inlineNs, rounds]() {
+        auto begin = steady_clock::now();
+        for (int i = 0; i < rounds; i++) looper->wait([]() {});
+        inlineNs = (double)duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+    });
+    report("wait_cost", "looper_thread", "mean", inlineNs / rounds / 1000.0, "us");
+    stopLooper(looper);
+}
+
+static void handlerFanout()
+{
+    const int64_t events = quick ? 20000 : 200000;
+    for (int handlers = 1; handlers <= 64; handlers *= 8) {
+        IdleLoop loop;
+        auto looper = startLooper(&loop);
+        int64_t *sum = new int64_t(0);
+        for (int h = 0; h < handlers; h++) {
+            looper->on(BENCH_EVENT, [sum](int64_t &v) { *sum += v; });
+        }
+        auto start = steady_clock::now();
+        for (int64_t i = 0; i < events; i++) looper->emit(BENCH_EVENT, (int64_t)1);
+        looper->wait([]() {});
+        double ns = (double)duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+        if (*sum != events * handlers) {
+            std::cerr << "fanout: lost calls " << *sum << " / " << events * handlers << std::endl;
+            failures += 1;
+        }
+        report("handler_fanout", "handlers=" + std::to_string(handlers), "per_event", ns / events, "ns");
+        report("handler_fanout", "handlers=" + std::to_string(handlers), "per_call", ns / events / handlers, "ns");
+        stopLooper(looper);
+        delete sum;
+    }
+}
+
+static void tickJitter(const char *name, TickMode mode)
+{
+    const double intervalMs = 1000.0 / 60;
+    TickRecorder recorder;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &recorder, 17);
+    looper->setUpdateInterval(intervalMs);
+    looper->setTickMode(mode);
+    looper->run();
+    std::this_thread::sleep_for(milliseconds(quick ? 500 : 3000));
+    looper->syncStop();
+    looper->join();
+
+    if (recorder.ticks.size() < 2) {
+        std::cerr << "tick_jitter: " << name << " did not tick" << std::endl;
+        failures += 1;
+        return;
+    }
+    LatencyHistogram hist;
+    for (size_t i = 1; i < recorder.ticks.size(); i++) {
+        int64_t dev = (recorder.ticks[i] - recorder.ticks[i - 1]) - (int64_t)(intervalMs * 1e6);
+        hist.record((uint64_t)(dev < 0 ? -dev : dev));
+    }
+    reportHistogram("tick_jitter", name, hist.snapshot());
+}
+
+static void writeJson(const std::string &path)
+{
+    std::ofstream out(path.c_str());
+    if (!out) {
+        std::cerr << "can not write " << path << std::endl;
+        failures += 1;
+        return;
+    }
+    out << "{\"revision\": \"" << LOOP_BENCH_REVISION << "\", \"quick\": " << (quick ? "true" : "false") << ", \"results\": [\n";
+    for (size_t i = 0; i < records.size(); i++) {
+        const BenchRecord &r = records[i];
+        out << "  {\"bench\": \"" << r.bench << "\", \"param\": \"" << r.param << "\", \"metric\": \"" << r.metric
+            << "\", \"value\": " << r.value << ", \"unit\": \"" << r.unit << "\"}" << (i + 1 < records.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+int main(int argc, char **argv)
+{
+    std::string jsonPath = "bench_results.json";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) quick = true;
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonPath = argv[++i];
+    }
+
+    std::cout << "bench\tparam\tmetric\tvalue" << std::endl;
+    emitThroughput();
+    dispatchRoundTrip();
+    waitCost();
+    handlerFanout();
+    tickJitter("uv_timer", TickMode::UV_TIMER);
+    tickJitter("precise", TickMode::PRECISE);
+
+    writeJson(jsonPath);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+# runs while building bench_looper: writes the checked out commit to OUT.
+#   cmake -DGIT_EXECUTABLE=... -DSRC=<source dir> -DOUT=<header> -P bench_revision.cmake
+set(rev "")
+if(GIT_EXECUTABLE)
+    execute_process(COMMAND ${GIT_EXECUTABLE} rev-parse --short HEAD
+        WORKING_DIRECTORY ${SRC}
+        OUTPUT_VARIABLE rev
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+        ERROR_QUIET)
+endif()
+if(rev)
+    set(content "#define LOOP_BENCH_REVISION \"${rev}\"\n")
+else()
+    set(content "// not a git checkout, the revision stays unknown\n")
+endif()
+# unchanged content keeps the old header, so staging files does not rebuild the benchmark
+set(old "")
+if(EXISTS ${OUT})
+    file(READ ${OUT} old)
+endif()
+if(NOT old STREQUAL content)
+    file(WRITE ${OUT} "${content}")
+endif()
@@ -0,0 +1,102 @@
+#include "Looper.h"
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+
+#define DISPATCH_COUNT 100000
+
+using namespace cocos2d::loop;
+
+static std::atomic<int64_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+int64_t total = 0;
+
+struct Payload {
+    int64_t a, b, c, d;
+};
+
+// a re-dispatch wrapper owns the task it forwards
+struct Rewrap {
+    Looper<int64_t>::DispatchF inner;
+    void operator()() { inner(); }
+};
+typedef UniqueFunction<void(), 128> WideTask;
+static_assert(WideTask::fitsInline<Rewrap>(), "a callable holding a DispatchF must be storable inline");
+
+int main(int argc, char **argv)
+{
+    IdleLoop loop;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &loop, 1000);
+    looper->run();
+
+    Payload p = { 1, 2, 3, 4 };
+    int64_t *dst = &total;
+
+    // what every dispatch paid for the closure alone when DispatchF was std::function
+    int64_t before = allocations.load();
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        std::function<void()> fn([p, dst]() { *dst += p.a; });
+        fn();
+    }
+    std::cout << "std::function closure allocs/op: " << (double)(allocations.load() - before) / DISPATCH_COUNT << std::endl;
+
+    before = allocations.load();
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        Looper<int64_t>::DispatchF fn([p, dst]() { *dst += p.a; });
+        fn();
+    }
+    std::cout << "DispatchF closure allocs/op: " << (double)(allocations.load() - before) / DISPATCH_COUNT << std::endl;
+
+    before = allocations.load();
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        WideTask fn(Rewrap{ Looper<int64_t>::DispatchF([dst]() { *dst += 1; }) });
+        WideTask moved(std::move(fn));
+        moved();
+    }
+    int64_t wrapAllocs = allocations.load() - before;
+    std::cout << "wrapped DispatchF allocs/op: " << (double)wrapAllocs / DISPATCH_COUNT << std::endl;
+
+    looper->wait([]() { total = 0; });
+    before = allocations.load();
+    for (int i = 0; i < DISPATCH_COUNT; i++) {
+        looper->dispatch([p, dst]() { *dst += p.a + p.b + p.c + p.d; });
+    }
+    looper->wait([]() {});
+    std::cout << "dispatch allocs/op (mailbox node included): " << (double)(allocations.load() - before) / DISPATCH_COUNT
+        << ", total " << total << ", expect " << (int64_t)DISPATCH_COUNT * 10 << std::endl;
+
+    looper->syncStop();
+    looper->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return wrapAllocs == 0 ? 0 : 1;
+}
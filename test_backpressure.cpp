@@ -0,0 +1,133 @@
+#include "Looper.h"
+#include "LoopEvent.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+
+#include <thread>
+
+#define CAPACITY 1000
+#define BURST 5000
+#define STALL_MS 300
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+static const EventId BLOCKING = EventId::of("blocking");
+static const EventId FAILING = EventId::of("failing");
+static const EventId NEWEST = EventId::of("drop_newest");
+static const EventId OLDEST = EventId::of("drop_oldest");
+
+int64_t handled = 0;
+int64_t firstOldest = -1; // only touched on the looper thread
+
+static Looper<int64_t>::Ptr startStalled(IdleLoop *loop)
+{
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::MAIN_THREAD, loop, 1000);
+    looper->setCapacity(CAPACITY, OverflowPolicy::BLOCK, milliseconds(50));
+    looper->setOverflowPolicy(FAILING, OverflowPolicy::FAIL);
+    looper->setOverflowPolicy(NEWEST, OverflowPolicy::DROP_NEWEST);
+    looper->setOverflowPolicy(OLDEST, OverflowPolicy::DROP_OLDEST, 64);
+    auto count = [](int64_t &v) { handled += 1; };
+    looper->on(BLOCKING, count);
+    looper->on(FAILING, count);
+    looper->on(NEWEST, count);
+    looper->on(OLDEST, [](int64_t &v) {
+        if (firstOldest < 0) firstOldest = v;
+        handled += 1;
+    });
+    looper->run();
+    looper->wait([]() {
+        handled = 0;
+        firstOldest = -1;
+    });
+    // a long pause on the consumer, like a gc on the main thread
+    looper->dispatch([]() { std::this_thread::sleep_for(milliseconds(STALL_MS)); });
+    return looper;
+}
+
+static bool burst(const char *title, EventId id, bool useTry)
+{
+    IdleLoop loop;
+    auto looper = startStalled(&loop);
+    int accepted = 0;
+    double peakFill = 0;
+    auto start = steady_clock::now();
+    for (int64_t i = 0; i < BURST; i++) {
+        if (useTry ? looper->tryEmit(id, i) : looper->emit(id, i)) accepted += 1;
+        if (looper->fillLevel() > peakFill) peakFill = looper->fillLevel();
+    }
+    auto emitMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    looper->wait([]() {});
+    int64_t seen = 0, first = 0;
+    looper->wait([&seen, &first]() {
+        seen = handled;
+        first = firstOldest;
+    });
+    auto st = looper->getOverflowStats();
+    std::cout << title << ": accepted " << accepted << "/" << BURST << " handled " << seen << " in " << emitMs << " ms, peak fill "
+        << peakFill * 100 << "%, rejected " << st.rejected << " dropped newest " << st.droppedNewest
+        << " dropped oldest " << st.droppedOldest << " blocked " << st.blocked << " timeouts " << st.blockTimeouts;
+    if (id == OLDEST) std::cout << ", first kept " << first;
+    std::cout << std::endl;
+    looper->syncStop();
+    looper->join();
+
+    //whatever was accepted is handled, the rest shows up in exactly one counter
+    bool ok = seen == accepted && peakFill <= 1.0;
+    if (id == OLDEST) ok = accepted == BURST && (int64_t)st.droppedOldest + seen == BURST && first == BURST - 64;
+    else if (id == NEWEST) ok = ok && (int64_t)st.droppedNewest == BURST - accepted;
+    else if (id == FAILING || useTry) ok = ok && (int64_t)st.rejected == BURST - accepted;
+    else ok = ok && (int64_t)st.blockTimeouts == BURST - accepted;
+    return ok;
+}
+
+// the library's own event class: no default constructor and no assignment
+static bool loopEventLane()
+{
+    IdleLoop loop;
+    auto looper = std::make_shared<Looper<LoopEvent>>(ThreadCategory::MAIN_THREAD, &loop, 1000);
+    looper->setOverflowPolicy(OLDEST, OverflowPolicy::DROP_OLDEST, 64);
+    int64_t seen = 0;
+    std::string last;
+    looper->on(OLDEST, [&seen, &last](LoopEvent &ev) {
+        seen += 1;
+        last = ev.getName();
+    });
+    looper->run();
+    looper->dispatch([]() { std::this_thread::sleep_for(milliseconds(STALL_MS)); });
+    for (int i = 0; i < BURST; i++) {
+        LoopEvent ev("msg");
+        ev.setName(i + 1 == BURST ? "last" : "older");
+        looper->emit(OLDEST, std::move(ev));
+    }
+    looper->wait([]() {});
+    auto st = looper->getOverflowStats();
+    std::cout << "LoopEvent  : handled " << seen << " dropped oldest " << st.droppedOldest << ", last kept " << last << std::endl;
+    looper->syncStop();
+    looper->join();
+    return seen == 64 && (int64_t)st.droppedOldest == BURST - 64 && last == "last";
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = burst("block      ", BLOCKING, false);
+    ok = burst("tryEmit    ", BLOCKING, true) && ok;
+    ok = burst("fail       ", FAILING, false) && ok;
+    ok = burst("drop newest", NEWEST, false) && ok;
+    ok = burst("drop oldest", OLDEST, false) && ok;
+    ok = loopEventLane() && ok;
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+
+#include <thread>
+
+#define FLOOD_COUNT 1000000
+#define TICK_MS 10
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+// records the longest gap between two ticks while the mailbox is flooded
+class TickGap : public Loop {
+public:
+    void update(int64_t dtUs)
+    {
+        //posting to its own looper from the tick drains inline, that drain must keep the budget
+        if (self) self->dispatch([]() {});
+        auto now = steady_clock::now();
+        if (ticks > 0) {
+            int64_t gap = duration_cast<microseconds>(now - last).count();
+            if (gap > maxGapUs) maxGapUs = gap;
+        }
+        last = now;
+        ticks += 1;
+    }
+
+    time_point<steady_clock> last;
+    int64_t maxGapUs = 0;
+    int64_t ticks = 0;
+    Looper<int64_t> *self = nullptr;
+};
+
+static const EventId WORK = EventId::of("work");
+
+static void burn()
+{
+    volatile int64_t x = 0;
+    for (int i = 0; i < 300; i++) x = x + i;
+}
+
+std::atomic<int64_t> floodGapUs(-1);
+std::atomic<bool> posted(false);
+
+//returns how often the budget cut a drain short, a full drain in between leaves hardly any
+static uint64_t flood(const char *title, size_t items, microseconds time, bool redispatch = false)
+{
+    TickGap gap;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::MAIN_THREAD, &gap, TICK_MS);
+    if (redispatch) gap.self = looper.get();
+    looper->setOverrunPolicy(OverrunPolicy::COALESCE);
+    looper->setDrainBudget(items, time);
+    looper->on(WORK, [&gap](int64_t &v) {
+        burn();
+        if (v == FLOOD_COUNT - 1) {
+            int64_t sinceLast = duration_cast<microseconds>(steady_clock::now() - gap.last).count();
+            floodGapUs = sinceLast > gap.maxGapUs ? sinceLast : gap.maxGapUs;
+        }
+    });
+    looper->run();
+    std::this_thread::sleep_for(milliseconds(3 * TICK_MS));
+    floodGapUs = -1;
+    posted = false;
+
+    // hold the looper until the whole backlog is queued, the worst case for a full drain
+    looper->dispatch([&gap]() {
+        while (!posted.load()) std::this_thread::sleep_for(milliseconds(1));
+        gap.maxGapUs = 0;
+        gap.last = steady_clock::now();
+    });
+    for (int64_t i = 0; i < FLOOD_COUNT; i++) looper->emit(WORK, i);
+    posted = true;
+    auto start = steady_clock::now();
+    while (floodGapUs.load() < 0) std::this_thread::sleep_for(milliseconds(1));
+    auto ms = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    auto st = looper->getDrainStats();
+    std::cout << title << ": " << FLOOD_COUNT << " items in " << ms << " ms, longest tick gap " << floodGapUs / 1000.0
+        << " ms (interval " << TICK_MS << " ms), carry overs " << st.carryOvers << std::endl;
+    looper->syncStop();
+    looper->join();
+    return st.carryOvers;
+}
+
+int main(int argc, char **argv)
+{
+    flood("unlimited      ", 0, microseconds(0));
+    const uint64_t slices = FLOOD_COUNT / 1000;
+    bool ok = flood("1000 items     ", 1000, microseconds(0)) >= slices - 1;
+    ok = flood("2 ms           ", 0, microseconds(2000)) > 0 && ok;
+    ok = flood("1000 items+tick", 1000, microseconds(0), true) >= slices - 1 && ok;
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
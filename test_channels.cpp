@@ -0,0 +1,119 @@
+#include "Looper.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <memory>
+
+#include <thread>
+
+#define EMIT_COUNT 1000000
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+struct PositionUpdate {
+    int entity;
+    float x, y, z;
+};
+
+struct NetPacket {
+    NetPacket(int conn, const std::string &body) : conn(conn), body(body) {}
+    int conn;
+    std::string body;
+};
+
+static const Channel<PositionUpdate> POSITIONS("positions");
+static const Channel<NetPacket> PACKETS("packets");
+static const Channel<int> PACKETS_AS_INT("packets");   // same name, other payload type
+static const Channel<int> OWNED("owned");
+static const EventId BOXED = EventId::of("boxed");
+
+std::atomic<int64_t> positions(0);
+std::atomic<int64_t> packets(0);
+std::atomic<int64_t> boxed(0);
+std::atomic<int64_t> owned(0);
+double sumX = 0;            // only touched on the looper thread
+size_t packetBytes = 0;
+
+struct AddOwned {
+    std::unique_ptr<int> base;
+    void operator()(int &v) { owned += *base + v; }
+};
+
+static void waitFor(std::atomic<int64_t> &counter, int64_t n)
+{
+    while (counter.load() < n) std::this_thread::sleep_for(microseconds(100));
+}
+
+int main(int argc, char **argv)
+{
+    IdleLoop loop;
+    //the looper type is still parameterised, the channels carry their own payloads
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::MAIN_THREAD, &loop, 1000);
+    looper->on(POSITIONS, [](PositionUpdate &p) {
+        sumX += p.x;
+        positions += 1;
+    });
+    looper->on(PACKETS, [](NetPacket &p) {
+        packetBytes += p.body.size();
+        packets += 1;
+    });
+    //no int handler yet, must not leave an empty table behind
+    looper->off(PACKETS_AS_INT);
+    //handlers are move only, they may own what they capture
+    looper->on(OWNED, AddOwned{ std::unique_ptr<int>(new int(40)) });
+    looper->on(BOXED, [](int64_t &v) {
+        boxed += 1;
+    });
+    looper->run();
+
+    looper->emit(PACKETS, NetPacket(1, "hello"));
+    looper->emplace(PACKETS, 2, "world!");
+    waitFor(packets, 2);
+    looper->wait([]() {});
+    std::cout << "packets: " << packets << ", " << packetBytes << " bytes" << std::endl;
+    looper->emit(PACKETS_AS_INT, 7);
+    looper->wait([]() {});
+    looper->emit(OWNED, 2);
+    looper->wait([]() {});
+    std::cout << "same name as int: " << packets << " packets, owned " << owned << std::endl;
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < EMIT_COUNT; i++) {
+        looper->emit(POSITIONS, PositionUpdate{ i, 1.0f, 2.0f, 3.0f });
+    }
+    waitFor(positions, EMIT_COUNT);
+    auto typedMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    for (int64_t i = 0; i < EMIT_COUNT; i++) {
+        looper->emit(BOXED, i);
+    }
+    waitFor(boxed, EMIT_COUNT);
+    auto eventMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+
+    looper->wait([]() {
+        std::cout << "positions: " << positions << ", sum x " << sumX << std::endl;
+    });
+    std::cout << "typed channel: " << EMIT_COUNT << " emits in " << typedMs << " ms, looper events: " << eventMs << " ms" << std::endl;
+
+    looper->syncStop();
+    looper->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    //the int emit on the packets name must not reach the packet handler
+    return packets == 2 && packetBytes == 11 && owned == 42 && positions == EMIT_COUNT && sumX == EMIT_COUNT
+        && boxed == EMIT_COUNT ? 0 : 1;
+}
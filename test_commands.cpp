@@ -0,0 +1,209 @@
+#include "CommandChannel.h"
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <new>
+
+#include <thread>
+
+#define FRAME_COUNT 300
+#define COMMANDS_PER_FRAME 2000
+#define LANE_FRAMES 2000
+#define LANE_COMMANDS 50
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+static std::atomic<int64_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+struct Transform {
+    int entity;
+    float m[12];
+};
+
+static const EventId MOVE = EventId::of("move");
+
+// render side state, only touched on the render thread
+int64_t moved = 0;
+int64_t destroyed = 0;
+int64_t lastEntity = -1;
+int64_t outOfOrder = 0;
+
+static void apply(int entity)
+{
+    if (entity <= lastEntity) outOfOrder += 1;
+    lastEntity = entity;
+    moved += 1;
+}
+
+static void frameDone()
+{
+    lastEntity = -1;
+}
+
+//what the physics thread pays per frame, generic emit against the command channel
+static void viaEmit(Looper<int64_t>::Ptr physics, Looper<int64_t>::Ptr render)
+{
+    render->on(MOVE, [](int64_t &entity) {
+        if (entity < 0) frameDone();
+        else apply((int)entity);
+    });
+    int64_t allocs = 0;
+    auto start = steady_clock::now();
+    physics->wait([render, &allocs]() {
+        int64_t before = allocations.load();
+        for (int f = 0; f < FRAME_COUNT; f++) {
+            for (int i = 0; i < COMMANDS_PER_FRAME; i++) render->emit(MOVE, (int64_t)i);
+            render->emit(MOVE, (int64_t)-1);
+        }
+        allocs = allocations.load() - before;
+    });
+    render->wait([]() {});
+    auto us = duration_cast<microseconds>(steady_clock::now() - start).count();
+    auto st = render->getDrainStats();
+    std::cout << "emit    : " << (double)us / FRAME_COUNT << " us/frame, allocs/frame " << (double)allocs / FRAME_COUNT
+        << ", wakeups " << st.wakeups << std::endl;
+}
+
+static bool viaChannel(Looper<int64_t>::Ptr physics, Looper<int64_t>::Ptr render)
+{
+    CommandChannel<int64_t> channel(render);
+    int64_t allocs = 0;
+    auto start = steady_clock::now();
+    physics->wait([&channel, &allocs]() {
+        int64_t before = 0;
+        for (int f = 0; f < FRAME_COUNT; f++) {
+            if (f == 3) before = allocations.load(); //the arenas have grown by then
+            for (int i = 0; i < COMMANDS_PER_FRAME; i++) {
+                if (i % 4 == 0) {
+                    //variable sized: every fourth command carries a whole transform
+                    Transform t = { i, {} };
+                    channel.record([t]() { apply(t.entity); });
+                }
+                else {
+                    channel.record([i]() { apply(i); });
+                }
+            }
+            channel.record([]() { frameDone(); });
+            channel.submit();
+        }
+        allocs = allocations.load() - before;
+        channel.flush();
+    });
+    auto us = duration_cast<microseconds>(steady_clock::now() - start).count();
+    auto st = channel.getStats();
+    std::cout << "channel : " << (double)us / FRAME_COUNT << " us/frame, allocs/frame " << (double)allocs / (FRAME_COUNT - 3)
+        << ", frames " << st.frames << ", commands " << st.commands << ", stalls " << st.stalls << std::endl;
+    return st.frames == FRAME_COUNT && st.commands == (uint64_t)FRAME_COUNT * (COMMANDS_PER_FRAME + 1);
+}
+
+// render side, per channel: the frame and the command expected next
+int64_t laneFrame[2] = {};
+int64_t laneCommand[2] = {};
+int64_t laneErrors = 0;
+
+static void laneApply(int lane, int64_t frame, int64_t i)
+{
+    if (frame != laneFrame[lane] || i != laneCommand[lane]) laneErrors += 1;
+    laneCommand[lane] += 1;
+}
+
+static void laneFrameDone(int lane)
+{
+    if (laneCommand[lane] != LANE_COMMANDS) laneErrors += 1;
+    laneFrame[lane] += 1;
+    laneCommand[lane] = 0;
+}
+
+//an urgent and a normal channel into one looper, with other mail on every lane in between
+static bool viaLanes(Looper<int64_t>::Ptr physics, Looper<int64_t>::Ptr render)
+{
+    CommandChannel<int64_t> normal(render, 2, 4096);
+    CommandChannel<int64_t> urgent(render, 2, 4096, MailPriority::URGENT);
+    CommandChannel<int64_t> *channels[2] = { &normal, &urgent };
+    std::atomic<int64_t> noise(0);
+    physics->wait([render, &channels, &noise]() {
+        for (int64_t f = 0; f < LANE_FRAMES; f++) {
+            for (int lane = 0; lane < 2; lane++) {
+                for (int64_t i = 0; i < LANE_COMMANDS; i++) {
+                    channels[lane]->record([lane, f, i]() { laneApply(lane, f, i); });
+                }
+                channels[lane]->record([lane]() { laneFrameDone(lane); });
+                channels[lane]->submit();
+            }
+            render->dispatch([&noise]() { noise.fetch_add(1); }, MailPriority::URGENT);
+            render->dispatch([&noise]() { noise.fetch_add(1); }, MailPriority::BACKGROUND);
+        }
+        channels[0]->flush();
+        channels[1]->flush();
+    });
+    render->wait([]() {}, MailPriority::BACKGROUND);
+    bool ok = false;
+    render->wait([&ok, &noise]() {
+        ok = laneErrors == 0 && laneFrame[0] == LANE_FRAMES && laneFrame[1] == LANE_FRAMES && noise.load() == 2 * LANE_FRAMES;
+        std::cout << "lanes   : " << laneFrame[0] << " normal and " << laneFrame[1] << " urgent frames, "
+            << laneErrors << " torn or out of order" << std::endl;
+    });
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    IdleLoop loop;
+    auto physics = std::make_shared<Looper<int64_t>>(ThreadCategory::PHYSICS_THREAD, &loop, 1000);
+    auto render = std::make_shared<Looper<int64_t>>(ThreadCategory::RENDER_THREAD, &loop, 1000);
+    physics->run();
+    render->run();
+
+    const int64_t applied = (int64_t)FRAME_COUNT * COMMANDS_PER_FRAME;
+    bool ok = true;
+    viaEmit(physics, render);
+    render->wait([&ok, applied]() {
+        std::cout << "          " << moved << " applied, " << outOfOrder << " out of order" << std::endl;
+        ok = ok && moved == applied && outOfOrder == 0;
+        moved = 0;
+    });
+    ok = viaChannel(physics, render) && ok;
+    render->wait([&ok, applied]() {
+        std::cout << "          " << moved << " applied, " << outOfOrder << " out of order" << std::endl;
+        ok = ok && moved == applied && outOfOrder == 0;
+    });
+    ok = viaLanes(physics, render) && ok;
+
+    physics->syncStop();
+    render->syncStop();
+    physics->join();
+    render->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
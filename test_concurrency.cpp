@@ -29,7 +29,7 @@ public:
         std::cout << "destroy loop" << std::endl;
     }
 
-    void update(int dtms) //ticker
+    void update(int64_t dtUs) //ticker
     {
       //  std::cout << "ticker inspect total " << total << std::endl;
     }
@@ -65,14 +65,18 @@ int main(int argc, char **argv)
         generators[i]->join();
     }
 
-    sumLooper->wait([]() {
+    bool ok = false;
+    sumLooper->wait([&ok]() {
         std::cout << "total value is " << total << ", expect " << (MAX_GENERATOR_THREAD * GENERATE_COUNT) << std::endl;
+        ok = total == MAX_GENERATOR_THREAD * GENERATE_COUNT;
     });
 
     sumLooper->syncStop();
 
     
+#ifdef _WIN32
     system("pause");
+#endif
 
-    return 0;
+    return ok ? 0 : 1;
 }
\ No newline at end of file
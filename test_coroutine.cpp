@@ -0,0 +1,96 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <atomic>
+
+#include <thread>
+
+using namespace cocos2d::loop;
+
+#ifdef CC_LOOP_COROUTINES
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+typedef Looper<int64_t> Worker;
+
+std::atomic<bool> finished(false);
+std::atomic<bool> misplaced(false);    // a step resumed off the looper it awaited
+std::atomic<int64_t> applied(0);
+
+static void printThreadMsg(const char *message)
+{
+    std::cout << "[tid] " << std::this_thread::get_id() << " " << message << std::endl;
+}
+
+static Task<size_t> parse(Worker *worker, std::string text)
+{
+    co_await worker->schedule();
+    if (!worker->isCurrentThread()) misplaced = true;
+    printThreadMsg("parse");
+    co_return text.size();
+}
+
+// load on net -> parse on worker -> apply on main, each hop through the looper mailbox
+static Task<> flow(Worker *net, Worker *worker, Worker *mainLooper)
+{
+    co_await net->schedule();
+    if (!net->isCurrentThread()) misplaced = true;
+    printThreadMsg("load");
+    std::string text = "{\"hello\":\"looper\"}";
+
+    size_t size = co_await parse(worker, text);
+
+    int64_t doubled = co_await worker->submit([size]() { return (int64_t)size * 2; });
+
+    co_await mainLooper->schedule();
+    if (!mainLooper->isCurrentThread()) misplaced = true;
+    applied = doubled;
+    char buff[40] = { 0 };
+    snprintf(buff, 40, "apply %d %d", (int)size, (int)doubled);
+    printThreadMsg(buff);
+    finished = true;
+}
+
+int main(int argc, char **argv)
+{
+    IdleLoop loop;
+    auto net = std::make_shared<Worker>(ThreadCategory::NET_THREAD, &loop, 1000);
+    auto worker = std::make_shared<Worker>(ThreadCategory::ANY_THREAD, &loop, 1000);
+    auto mainLooper = std::make_shared<Worker>(ThreadCategory::MAIN_THREAD, &loop, 1000);
+    net->run();
+    worker->run();
+    mainLooper->run();
+
+    printThreadMsg("start");
+    flow(net.get(), worker.get(), mainLooper.get()).detach();
+
+    while (!finished) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    net->syncStop();
+    worker->syncStop();
+    mainLooper->syncStop();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return !misplaced && applied == 2 * 18 ? 0 : 1;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    std::cout << "coroutines are not available with this compiler" << std::endl;
+    return 0;
+}
+
+#endif
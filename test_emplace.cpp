@@ -0,0 +1,45 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <memory>
+
+#include <thread>
+
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+// move-only payloads are built in the mailbox and handed to handlers by reference
+typedef std::unique_ptr<std::vector<char> > Buffer;
+
+int main(int argc, char **argv)
+{
+    IdleLoop loop;
+    auto looper = std::make_shared<Looper<Buffer>>(ThreadCategory::ANY_THREAD, &loop, 1000);
+    int buffers = 0;
+    size_t bytes = 0;
+    looper->on("buffer", [&buffers, &bytes](Buffer &buf) {
+        buffers += 1;
+        bytes += buf->size();
+    });
+    looper->run();
+
+    looper->emit("buffer", Buffer(new std::vector<char>(1024)));
+    looper->emplace(EventId::of("buffer"), new std::vector<char>(4096));
+    looper->wait([]() {});
+    std::cout << "move-only payloads: " << buffers << " buffers, " << bytes << " bytes" << std::endl;
+
+    looper->syncStop();
+    looper->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return buffers == 2 && bytes == 1024 + 4096 ? 0 : 1;
+}
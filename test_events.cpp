@@ -24,14 +24,14 @@ public:
         std::cout << "destroy loop" << std::endl;
     }
 
-    void update(int dtms) //ticker
+    void update(int64_t dtUs) //ticker
     {
-        std::cout << "tick pass " << dtms << std::endl;
+        std::cout << "tick pass " << dtUs << " us" << std::endl;
     }
 };
 
 
-int64_t total = 0;
+int64_t total = 0; // every dispatch and the event bump it in turn
 
 static void printThreadMsg(const char *message)
 {
@@ -49,6 +49,7 @@ int main(int argc, char **argv)
     printThreadMsg("main thread");
     sumLooper->dispatch([](){
         printThreadMsg("dispatch 1");
+        total += 1;
     });
 
     for (int i = 0; i < 10; i++) {
@@ -56,13 +57,15 @@ int main(int argc, char **argv)
             char buff[30] = { 0 };
             snprintf(buff, 30, "dispatch %d", i + 2);
             printThreadMsg(buff);
+            if (total == i + 1) total += 1;
         });
     }
 
     sumLooper->on("ddd", [](int64_t &msg) {
         char buff[30] = { 0 };
-        snprintf(buff, 30, "event %lld", msg);
+        snprintf(buff, 30, "event %lld", (long long)msg);
         printThreadMsg(buff);
+        if (total == 11 && msg == 32223) total += 1;
     });
 
     int64_t d = 32223;
@@ -70,7 +73,9 @@ int main(int argc, char **argv)
 
     sumLooper->syncStop();
 
+#ifdef _WIN32
     system("pause");
+#endif
 
-    return 0;
+    return total == 12 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "LooperGroup.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <set>
+#include <mutex>
+
+#include <thread>
+
+#define WORKER_COUNT 4
+#define TASK_COUNT 20000
+#define HEAVY_EVERY 4       // every 4th task is the heavy one, round robin piles them on one looper
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+std::atomic<int> finished(0);
+std::atomic<uint64_t> sink(0);
+int failures = 0;
+
+static void burn(int rounds)
+{
+    uint64_t x = rounds;
+    for (int i = 0; i < rounds * 1000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    sink.fetch_add(x, std::memory_order_relaxed);
+    finished.fetch_add(1);
+}
+
+static int taskCost(int i)
+{
+    return i % HEAVY_EVERY == 0 ? 20 : 1;
+}
+
+static void waitFinished()
+{
+    while (finished.load() < TASK_COUNT) {
+        std::this_thread::sleep_for(microseconds(100));
+    }
+    //a task run twice would push it past the count
+    std::this_thread::sleep_for(milliseconds(10));
+    if (finished.load() != TASK_COUNT) failures += 1;
+}
+
+static int64_t roundRobin()
+{
+    IdleLoop loop;
+    std::vector<Looper<int64_t>::Ptr> loopers;
+    for (int i = 0; i < WORKER_COUNT; i++) {
+        loopers.push_back(std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &loop, 1000));
+        loopers.back()->run();
+    }
+    finished = 0;
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < TASK_COUNT; i++) {
+        int cost = taskCost(i);
+        loopers[i % WORKER_COUNT]->dispatch([cost]() { burn(cost); });
+    }
+    waitFinished();
+    auto cost = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+    for (auto &l : loopers) {
+        l->syncStop();
+        l->join();
+    }
+    return cost;
+}
+
+static int64_t stealing()
+{
+    LooperGroup<int64_t>::Options opts;
+    opts.minWorkers = WORKER_COUNT;
+    opts.maxWorkers = WORKER_COUNT;
+    LooperGroup<int64_t> group(opts);
+    group.start();
+    finished = 0;
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < TASK_COUNT; i++) {
+        int cost = taskCost(i);
+        group.dispatch([cost]() { burn(cost); });
+    }
+    waitFinished();
+    auto cost = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+    group.stop();
+    return cost;
+}
+
+static void elastic()
+{
+    LooperGroup<int64_t>::Options opts;
+    opts.minWorkers = 1;
+    opts.maxWorkers = WORKER_COUNT;
+    opts.idleTimeout = milliseconds(200);
+    LooperGroup<int64_t> group(opts);
+    group.start();
+    finished = 0;
+    for (int i = 0; i < TASK_COUNT; i++) {
+        int cost = taskCost(i);
+        group.dispatch([cost]() { burn(cost); });
+    }
+    size_t peak = group.size();
+    waitFinished();
+    std::this_thread::sleep_for(milliseconds(1000));
+    std::cout << "elastic pool: peak " << peak << " workers, " << group.size() << " after idle" << std::endl;
+    if (peak < 1 || peak > WORKER_COUNT || group.size() != opts.minWorkers) failures += 1;
+    group.stop();
+}
+
+//a task on one group feeding another must land on the other group's workers
+static void twoGroups()
+{
+    LooperGroup<int64_t>::Options opts;
+    opts.minWorkers = 1;
+    opts.maxWorkers = 1;
+    LooperGroup<int64_t> producer(opts);
+    opts.minWorkers = 2;
+    opts.maxWorkers = 2;
+    LooperGroup<int64_t> consumer(opts);
+    producer.start();
+    consumer.start();
+
+    std::mutex mtx;
+    std::set<std::thread::id> consumerThreads;
+    for (size_t i = 0; i < consumer.size(); i++) {
+        consumer.getWorker(i)->wait([&mtx, &consumerThreads]() {
+            std::lock_guard<std::mutex> guard(mtx);
+            consumerThreads.insert(std::this_thread::get_id());
+        });
+    }
+
+    std::atomic<int> done(0), misplaced(0);
+    producer.dispatch([&]() {
+        for (int i = 0; i < TASK_COUNT; i++) {
+            consumer.dispatch([&]() {
+                if (!consumerThreads.count(std::this_thread::get_id())) misplaced.fetch_add(1);
+                done.fetch_add(1);
+            });
+        }
+    });
+    while (done.load() < TASK_COUNT) {
+        std::this_thread::sleep_for(microseconds(100));
+    }
+    std::this_thread::sleep_for(milliseconds(50));
+    std::cout << "two groups: " << misplaced.load() << " tasks ran on the wrong group, queued " << producer.queued()
+        << "/" << consumer.queued() << std::endl;
+    if (misplaced.load() != 0 || producer.queued() != 0 || consumer.queued() != 0) failures += 1;
+    consumer.stop();
+    producer.stop();
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "round robin over " << WORKER_COUNT << " loopers: " << roundRobin() << " ms" << std::endl;
+    std::cout << "work stealing group of " << WORKER_COUNT << ": " << stealing() << " ms" << std::endl;
+    elastic();
+    twoGroups();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return failures ? 1 : 0;
+}
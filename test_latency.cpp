@@ -0,0 +1,69 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+
+#include <thread>
+
+#define SAMPLE_COUNT 5000
+#define SEND_INTERVAL_US 200
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+std::vector<int64_t> samples; // only touched on the looper thread
+
+static bool measure(const char *title, PollMode mode)
+{
+    IdleLoop loop;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::RENDER_THREAD, &loop, 1000);
+    looper->setPollMode(mode, microseconds(500));
+    looper->run();
+    looper->wait([]() {
+        samples.clear();
+        samples.reserve(SAMPLE_COUNT);
+    });
+
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        auto sent = steady_clock::now();
+        looper->dispatch([sent]() {
+            samples.push_back(duration_cast<nanoseconds>(steady_clock::now() - sent).count());
+        });
+        std::this_thread::sleep_for(microseconds(SEND_INTERVAL_US));
+    }
+
+    bool ok = false;
+    looper->wait([title, &ok]() {
+        ok = samples.size() == SAMPLE_COUNT;
+        std::sort(samples.begin(), samples.end());
+        size_t n = samples.size();
+        std::cout << title << " enqueue->execute us: p50 " << samples[n / 2] / 1000.0
+            << " p90 " << samples[n * 9 / 10] / 1000.0
+            << " p99 " << samples[n * 99 / 100] / 1000.0
+            << " p99.9 " << samples[n * 999 / 1000] / 1000.0
+            << " max " << samples[n - 1] / 1000.0 << std::endl;
+    });
+    looper->syncStop();
+    looper->join();
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = measure("sleep    ", PollMode::SLEEP);
+    ok = measure("busy poll", PollMode::BUSY_POLL) && ok;
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "LoopMgr.h"
+
+#include <iostream>
+#include <cstdint>
+#include <atomic>
+
+#include <thread>
+
+using namespace cocos2d::loop;
+
+class ValueGenerator : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+typedef LoopMgr<int64_t> Mgr;
+
+std::atomic<int> stepped(0);
+std::atomic<int> rendered(0);
+
+static void printThreadMsg(const char *message)
+{
+    std::cout << "[tid] " << std::this_thread::get_id() << " " << message << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    ValueGenerator physicsLoop;
+    ValueGenerator renderLoop;
+    Mgr &mgr = Mgr::getInstance();
+
+    Mgr::CategoryConfig physics;
+    physics.task = &physicsLoop;
+    physics.updateMs = 16;
+    physics.thread.name = "physics";
+    physics.thread.cpus.push_back(0);
+    physics.thread.nice = -5;
+    physics.thread.numaLocal = true;
+    mgr.configure(ThreadCategory::PHYSICS_THREAD, physics);
+
+    Mgr::CategoryConfig render;
+    render.task = &renderLoop;
+    render.updateMs = 16;
+    render.thread.name = "render";
+    render.thread.cpus.push_back((int)(std::thread::hardware_concurrency() > 1 ? 1 : 0));
+    mgr.configure(ThreadCategory::RENDER_THREAD, render);
+
+    Mgr::GroupOptions any;
+    any.minWorkers = 2;
+    any.maxWorkers = 2;
+    mgr.configureAnyThread(any);
+
+    mgr.start();
+
+    printThreadMsg("main");
+    mgr.dispatch(ThreadCategory::PHYSICS_THREAD, []() {
+        printThreadMsg("physics step");
+        if (Mgr::getInstance().get(ThreadCategory::PHYSICS_THREAD)->isCurrentThread()) stepped += 1;
+        Mgr::getInstance().dispatch(ThreadCategory::RENDER_THREAD, []() {
+            printThreadMsg("render frame");
+            if (Mgr::getInstance().get(ThreadCategory::RENDER_THREAD)->isCurrentThread()) rendered += 1;
+        });
+    });
+    auto answer = mgr.submit(ThreadCategory::ANY_THREAD, []() {
+        printThreadMsg("any thread job");
+        return 42;
+    });
+    int value = answer.get();
+    std::cout << "answer " << value << std::endl;
+    mgr.wait(ThreadCategory::PHYSICS_THREAD, []() {});
+    mgr.wait(ThreadCategory::RENDER_THREAD, []() {});
+
+    //the physics wait() ran after the step, so the render frame was queued ahead of the render wait()
+    bool ok = value == 42 && stepped == 1 && rendered == 1;
+    mgr.stop();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
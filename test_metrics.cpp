@@ -0,0 +1,95 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+
+#include <thread>
+
+#define PRODUCER_COUNT 4
+#define EMIT_COUNT 20000
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+static const EventId LIGHT = EventId::of("light");
+static const EventId HEAVY = EventId::of("heavy");
+
+static void burn(int64_t rounds)
+{
+    volatile int64_t x = 0;
+    for (int64_t i = 0; i < rounds; i++) x = x + i;
+}
+
+static void print(const char *title, const HistogramSnapshot &h)
+{
+    std::cout << "  " << title << " n " << h.count << " us: p50 " << h.percentile(0.5) / 1000.0
+        << " p99 " << h.percentile(0.99) / 1000.0 << " max " << h.max / 1000.0 << std::endl;
+}
+
+static MetricsSnapshot report(Looper<int64_t>::Ptr looper)
+{
+    MetricsSnapshot snap = looper->snapshot();
+    std::cout << "emitted " << snap.emitted << " dispatched " << snap.dispatched << " external " << snap.external
+        << " handled " << snap.handled << " depth " << snap.queueDepth
+        << " utilization " << snap.utilization() * 100 << "%" << std::endl;
+    print("enqueue->execute", snap.latency);
+    print("tick drift      ", snap.tickDrift);
+    for (auto &h : snap.handlerTime) {
+        print(("handler " + h.first + std::string(8 - h.first.size(), ' ')).c_str(), h.second);
+    }
+    return snap;
+}
+
+int main(int argc, char **argv)
+{
+    IdleLoop loop;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &loop, 10);
+    looper->setTimingMetrics(true);
+    looper->on(LIGHT, [](int64_t &v) { burn(v); });
+    looper->on(HEAVY, [](int64_t &v) { burn(v * 50); });
+    looper->run();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCER_COUNT; p++) {
+        producers.emplace_back([looper, p]() {
+            for (int i = 0; i < EMIT_COUNT; i++) {
+                looper->emit(i % 10 == 0 ? HEAVY : LIGHT, (int64_t)100);
+                if (i % 100 == 0) looper->dispatch([]() { burn(100); });
+                if (i % 1000 == 0) std::this_thread::sleep_for(milliseconds(1));
+            }
+        });
+    }
+    std::this_thread::sleep_for(milliseconds(20));
+    std::cout << "-- under load" << std::endl;
+    report(looper);
+
+    for (auto &t : producers) t.join();
+    looper->wait([]() {});
+    std::this_thread::sleep_for(milliseconds(500));
+    std::cout << "-- drained" << std::endl;
+    MetricsSnapshot snap = report(looper);
+    //every item is counted once on the way in and once when handled, the extra dispatch is the wait()
+    const uint64_t emitted = PRODUCER_COUNT * EMIT_COUNT;
+    bool ok = snap.emitted == emitted && snap.dispatched == emitted / 100 + 1 && snap.queueDepth == 0
+        && snap.handled == snap.emitted + snap.dispatched + snap.external && snap.latency.count == snap.handled;
+    for (auto &h : snap.handlerTime) {
+        if (h.first == "light") ok = ok && h.second.count == emitted * 9 / 10;
+        if (h.first == "heavy") ok = ok && h.second.count == emitted / 10;
+    }
+
+    looper->syncStop();
+    looper->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
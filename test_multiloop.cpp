@@ -0,0 +1,88 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+
+#include <thread>
+
+#define RUN_MS 2000
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+// counts its updates and remembers when the first one ran
+class CountLoop : public Loop {
+public:
+    explicit CountLoop(const char *name) : name(name) {}
+    void before() override { started = steady_clock::now(); }
+    void update(int64_t dtUs) override
+    {
+        if (updates.load() == 0) firstMs = duration_cast<microseconds>(steady_clock::now() - started).count() / 1000.0;
+        updates += 1;
+        sumDtUs += dtUs;
+    }
+    void after() override { afterCalls += 1; }
+
+    //never ahead of its own schedule, and not starved by the other loops on the thread
+    bool onSchedule(double intervalMs, double phaseMs = 0)
+    {
+        double ranMs = duration_cast<microseconds>(steady_clock::now() - started).count() / 1000.0;
+        double due = (ranMs - phaseMs) / intervalMs;
+        int64_t n = updates.load();
+        return n > 0 && n <= due + 1 && n >= due / 2;
+    }
+
+    void print()
+    {
+        int64_t n = updates.load();
+        std::cout << name << ": " << n << " updates, first after " << firstMs << " ms, mean dt "
+            << (n ? sumDtUs.load() / n / 1000.0 : 0.0) << " ms, after() " << afterCalls << std::endl;
+    }
+
+    const char *name;
+    steady_clock::time_point started;
+    double firstMs = 0;
+    std::atomic<int64_t> updates{ 0 };
+    std::atomic<int64_t> sumDtUs{ 0 };
+    std::atomic<int> afterCalls{ 0 };
+};
+
+int main(int argc, char **argv)
+{
+    CountLoop sim("simulation 60 Hz "), ai("ai 10 Hz         "), stats("stats 1 Hz +500ms");
+    CountLoop late("attached later 20 Hz");
+
+    //one thread, one uv loop, three rates
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::MAIN_THREAD, &sim, 1000);
+    looper->setUpdateInterval(1000.0 / 60);
+    looper->attachLoop(&ai, 100);
+    looper->attachLoop(&stats, 1000, 500);
+    looper->run();
+
+    std::this_thread::sleep_for(milliseconds(RUN_MS / 2));
+    looper->attachLoop(&late, 50);
+    std::this_thread::sleep_for(milliseconds(RUN_MS / 2));
+    looper->detachLoop(&ai);
+    int64_t aiAtDetach = ai.updates.load();
+    std::this_thread::sleep_for(milliseconds(300));
+
+    sim.print();
+    ai.print();
+    stats.print();
+    late.print();
+    std::cout << "ai updates after detach: " << ai.updates - aiAtDetach << std::endl;
+    bool ok = sim.onSchedule(1000.0 / 60) && stats.onSchedule(1000, 500) && late.onSchedule(50);
+    ok = ok && ai.updates == aiAtDetach && ai.afterCalls == 1 && ai.updates >= (RUN_MS / 100) / 2;
+
+    looper->syncStop();
+    looper->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
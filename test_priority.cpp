@@ -0,0 +1,103 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+
+#include <thread>
+
+#define TELEMETRY_COUNT 20000
+#define BACKGROUND_COUNT 100
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+static const EventId TELEMETRY = EventId::of("telemetry");
+static const EventId CLEANUP = EventId::of("cleanup");
+
+int64_t handledCount = 0;      // only touched on the looper thread
+int64_t firstBackgroundAt = -1;
+int64_t backgroundDone = 0;
+
+static void burn()
+{
+    volatile int64_t x = 0;
+    for (int i = 0; i < 1000; i++) x = x + i;
+}
+
+static Looper<int64_t>::Ptr startBusy(IdleLoop *loop)
+{
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::RENDER_THREAD, loop, 1000);
+    looper->on(TELEMETRY, [](int64_t &v) {
+        burn();
+        handledCount += 1;
+    });
+    looper->on(CLEANUP, [](int64_t &v) {
+        if (firstBackgroundAt < 0) firstBackgroundAt = handledCount;
+        backgroundDone += 1;
+        handledCount += 1;
+    });
+    looper->run();
+    looper->wait([]() {
+        handledCount = 0;
+        firstBackgroundAt = -1;
+        backgroundDone = 0;
+    });
+    //hold the looper while the backlog piles up
+    looper->dispatch([]() { std::this_thread::sleep_for(milliseconds(20)); });
+    for (int64_t i = 0; i < TELEMETRY_COUNT; i++) looper->emit(TELEMETRY, i);
+    return looper;
+}
+
+static bool waitBehindBacklog(const char *title, MailPriority prio)
+{
+    IdleLoop loop;
+    auto looper = startBusy(&loop);
+    int64_t seenBacklog = 0;
+    auto start = steady_clock::now();
+    looper->wait([&seenBacklog]() { seenBacklog = handledCount; }, prio);
+    auto us = duration_cast<microseconds>(steady_clock::now() - start).count();
+    std::cout << title << " wait() behind " << TELEMETRY_COUNT << " events: " << us << " us, ran after "
+        << seenBacklog << " of them" << std::endl;
+    looper->syncStop();
+    looper->join();
+    //normal mail queues behind the backlog, urgent mail overtakes it
+    return prio == MailPriority::URGENT ? seenBacklog < TELEMETRY_COUNT : seenBacklog == TELEMETRY_COUNT;
+}
+
+static bool backgroundStarvation()
+{
+    IdleLoop loop;
+    auto looper = startBusy(&loop);
+    for (int64_t i = 0; i < BACKGROUND_COUNT; i++) looper->emit(CLEANUP, i, MailPriority::BACKGROUND);
+    int64_t first = 0, done = 0;
+    looper->wait([&first, &done]() {
+        first = firstBackgroundAt;
+        done = backgroundDone;
+    }, MailPriority::BACKGROUND);
+    std::cout << "background: first of " << BACKGROUND_COUNT << " ran after " << first << " items, "
+        << done << " done when the backlog drained" << std::endl;
+    looper->syncStop();
+    looper->join();
+    //the starvation guard lets one background item through every BACKGROUND_EVERY (64) others
+    return first >= 0 && first <= 2 * 64 && done == BACKGROUND_COUNT;
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = waitBehindBacklog("normal", MailPriority::NORMAL);
+    ok = waitBehindBacklog("urgent", MailPriority::URGENT) && ok;
+    ok = backgroundStarvation() && ok;
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+#include "Looper.h"
+
+#include <iostream>
+#include <cstdint>
+#include <atomic>
+
+#include <thread>
+
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+int main(int argc, char **argv)
+{
+    IdleLoop computeLoop, uiLoop;
+    auto compute = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &computeLoop, 1000);
+    auto ui = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &uiLoop, 1000);
+    compute->run();
+    ui->run();
+
+    // compute on one looper, continue on another without blocking either
+    std::atomic<bool> computeThread(false), uiThread(false);
+    auto answer = compute->submit([compute, &computeThread]() {
+        computeThread = compute->isCurrentThread();
+        return 6 * 7;
+    });
+    auto printed = answer.then(ui, [ui, &uiThread](int v) {
+        uiThread = ui->isCurrentThread();
+        return v + 1;
+    });
+    int result = printed.get();
+    std::cout << "submit then: got " << result << ", computed on its looper " << computeThread
+        << ", continued on the other " << uiThread << std::endl;
+
+    compute->syncStop();
+    ui->syncStop();
+    compute->join();
+    ui->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return result == 43 && computeThread && uiThread ? 0 : 1;
+}
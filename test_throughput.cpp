@@ -0,0 +1,83 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+
+#include <thread>
+
+#define MAX_GENERATOR_THREAD 20
+#define TOTAL_EVENTS 2000000
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+int64_t total = 0; // only touched on the looper thread
+int failures = 0;
+static const EventId ADD = EventId::of("add");
+
+static double measure(int producers)
+{
+    IdleLoop loop;
+    auto sumLooper = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &loop, 1000);
+    sumLooper->on(ADD, [](int64_t &v) {
+        total += v;
+    });
+    sumLooper->run();
+    sumLooper->wait([]() { total = 0; });
+
+    const int perThread = TOTAL_EVENTS / producers;
+    auto start = high_resolution_clock::now();
+
+    std::vector<std::thread *> generators;
+    for (int i = 0; i < producers; i++) {
+        generators.push_back(new std::thread([sumLooper, perThread]() {
+            int64_t step = 1;
+            for (int j = 0; j < perThread; j++)
+            {
+                sumLooper->emit(ADD, step);
+            }
+        }));
+    }
+    for (auto *t : generators) {
+        t->join();
+        delete t;
+    }
+    sumLooper->wait([]() {});
+
+    auto cost = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    if (total != (int64_t)perThread * producers)
+    {
+        std::cerr << "lost events: " << total << " / " << (int64_t)perThread * producers << std::endl;
+        failures += 1;
+    }
+    auto st = sumLooper->getDrainStats();
+    std::cout << "  drains " << st.drains << ", items/drain " << st.itemsPerDrain() << ", max batch " << st.maxBatch
+        << ", wakeups/1k msgs " << st.wakeupsPer1k() << std::endl;
+    sumLooper->syncStop();
+    sumLooper->join();
+    return (double)perThread * producers / cost; // events per microsecond
+}
+
+int main(int argc, char **argv)
+{
+    std::cout << "producers\temit M/s" << std::endl;
+    for (int p = 1; p <= MAX_GENERATOR_THREAD; p *= 2) {
+        double rate = measure(p);
+        std::cout << p << "\t" << rate << std::endl;
+    }
+    double rate = measure(MAX_GENERATOR_THREAD);
+    std::cout << MAX_GENERATOR_THREAD << "\t" << rate << std::endl;
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return failures ? 1 : 0;
+}
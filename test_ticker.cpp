@@ -4,56 +4,148 @@
 #include <iostream>
 #include <cstdint>
 #include <chrono>
+#include <algorithm>
+#include <cmath>
 
 #include <thread>
 
-#define MAX_GENERATOR_THREAD 20
-#define GENERATE_COUNT 10000
+#define TICK_INTERVAL_MS (1000.0 / 60)
+#define RUN_MS 3000
 
 using namespace std::chrono;
 using namespace cocos2d::loop;
 
-class ValueGenerator : public Loop {
+class TickRecorder : public Loop {
 public:
 
     void before()
     {
-        std::cout << "prepare loop" << std::endl;
+        ticks.clear();
+        ticks.reserve(RUN_MS);
     }
 
-    void after()
+    void update(int64_t dtUs) //ticker
     {
-        std::cout << "destroy loop" << std::endl;
+        ticks.push_back(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
     }
 
-    void update(int dtms) //ticker
+    std::vector<int64_t> ticks;
+};
+
+int failures = 0;
+
+static void report(const char *title, TickMode mode)
+{
+    TickRecorder recorder;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, &recorder, 17);
+    looper->setUpdateInterval(TICK_INTERVAL_MS);
+    looper->setTickMode(mode);
+
+    looper->run();
+    std::this_thread::sleep_for(milliseconds(RUN_MS));
+    looper->syncStop();
+    looper->join();
+
+    //deviation of every tick period from the requested interval
+    std::vector<double> jitter;
+    for (size_t i = 1; i < recorder.ticks.size(); i++) {
+        double periodMs = (recorder.ticks[i] - recorder.ticks[i - 1]) / 1e6;
+        jitter.push_back(std::fabs(periodMs - TICK_INTERVAL_MS) * 1000.0);
+    }
+    //a loaded machine may miss ticks, but the schedule never runs ahead of the interval
+    size_t expected = (size_t)(RUN_MS / TICK_INTERVAL_MS);
+    if (recorder.ticks.size() < expected / 2 || recorder.ticks.size() > expected + expected / 20) failures += 1;
+    if (jitter.empty()) {
+        std::cout << title << ": no ticks" << std::endl;
+        return;
+    }
+    std::sort(jitter.begin(), jitter.end());
+    size_t n = jitter.size();
+    std::cout << title << ": " << recorder.ticks.size() << " ticks, jitter us p50 " << jitter[n / 2]
+        << " p99 " << jitter[n * 99 / 100] << " max " << jitter[n - 1] << std::endl;
+}
+
+// every HITCH_EVERY updates one takes HITCH_MS, several intervals
+#define HITCH_EVERY 30
+#define HITCH_MS 60
+
+class HitchLoop : public Loop {
+public:
+    void update(int64_t dtUs)
     {
-        auto now = duration_cast<microseconds>(high_resolution_clock::now().time_since_epoch()).count();
-        std::cout << now << std::endl;
+        updates += 1;
+        simulatedUs += dtUs;
+        auto now = steady_clock::now();
+        if (now - last < microseconds(1000)) burst += 1;
+        else burst = 1;
+        if (burst > maxBurst) maxBurst = burst;
+        last = now;
+        if (updates % HITCH_EVERY == 0) std::this_thread::sleep_for(milliseconds(HITCH_MS));
     }
-};
 
+    void interpolate(double alpha)
+    {
+        interpolations += 1;
+    }
 
-int64_t total = 0;
+    int64_t updates = 0;
+    int64_t simulatedUs = 0;
+    int64_t interpolations = 0;
+    int burst = 0;
+    int maxBurst = 0;
+    time_point<steady_clock> last;
+};
 
-static void printThreadMsg(const char *message)
+static void overrun(const char *title, OverrunPolicy policy)
 {
-    std::cout << "[tid] "<< std::this_thread::get_id() << " " << message << std::endl;
+    HitchLoop hitch;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::PHYSICS_THREAD, &hitch, 17);
+    looper->setUpdateInterval(TICK_INTERVAL_MS);
+    looper->setOverrunPolicy(policy, 3);
+    auto start = steady_clock::now();
+    looper->run();
+    std::this_thread::sleep_for(milliseconds(RUN_MS));
+    looper->syncStop();
+    looper->join();
+    auto wallMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    std::cout << title << ": " << hitch.updates << " updates, simulated " << hitch.simulatedUs / 1000
+        << " ms of " << wallMs << " ms, longest burst " << hitch.maxBurst
+        << ", interpolations " << hitch.interpolations << std::endl;
+
+    //no policy simulates time that has not passed, only DROP gives up the hitches
+    int64_t simulatedMs = hitch.simulatedUs / 1000;
+    bool ok = hitch.updates > 0 && simulatedMs <= wallMs + 1;
+    switch (policy)
+    {
+    case OverrunPolicy::CATCH_UP:
+        ok = ok && simulatedMs >= wallMs * 9 / 10 && hitch.maxBurst <= 3;
+        break;
+    case OverrunPolicy::DROP:
+        ok = ok && simulatedMs <= wallMs - HITCH_MS;
+        break;
+    case OverrunPolicy::COALESCE:
+        ok = ok && simulatedMs >= wallMs * 9 / 10;
+        break;
+    case OverrunPolicy::FIXED_STEP:
+        ok = ok && simulatedMs >= wallMs * 9 / 10 && hitch.interpolations > 0;
+        break;
+    }
+    if (!ok) failures += 1;
 }
 
-
 int main(int argc, char **argv)
 {
-    auto loop = std::make_shared<ValueGenerator>();
-    auto sumLooper = std::make_shared<Looper<int64_t>>(ThreadCategory::ANY_THREAD, loop.get(), 17);
-
-    sumLooper->run();
+    report("uv_timer", TickMode::UV_TIMER);
+    report("precise ", TickMode::PRECISE);
 
-    std::this_thread::sleep_for(milliseconds(3000));
-
-    sumLooper->syncStop();
+    overrun("catch up  ", OverrunPolicy::CATCH_UP);
+    overrun("drop      ", OverrunPolicy::DROP);
+    overrun("coalesce  ", OverrunPolicy::COALESCE);
+    overrun("fixed step", OverrunPolicy::FIXED_STEP);
 
+#ifdef _WIN32
     system("pause");
+#endif
 
-    return 0;
-}
\ No newline at end of file
+    return failures ? 1 : 0;
+}
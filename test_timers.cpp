@@ -0,0 +1,121 @@
+#include "Looper.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <random>
+
+#include <thread>
+
+#define TIMER_COUNT 200000
+#define MAX_DELAY_MS 2000
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+class IdleLoop : public Loop {
+public:
+    void update(int64_t dtUs) {}
+};
+
+std::atomic<int64_t> fired(0);
+std::atomic<int64_t> early(0);
+std::atomic<int64_t> maxLateUs(0);
+
+static void onFire(steady_clock::time_point deadline)
+{
+    auto now = steady_clock::now();
+    if (now < deadline) early += 1;
+    int64_t late = duration_cast<microseconds>(now - deadline).count();
+    if (late > maxLateUs.load()) maxLateUs = late;
+    fired += 1;
+}
+
+//a loaded machine fires late, give the stragglers a while before calling them lost
+template<typename Counter>
+static void waitFor(Counter &counter, int64_t n, milliseconds atMost)
+{
+    auto until = steady_clock::now() + atMost;
+    while (counter.load() < n && steady_clock::now() < until) std::this_thread::sleep_for(milliseconds(1));
+}
+
+//connection timeouts: arm a lot, cancel most of them before they fire
+static bool scale(Looper<int64_t>::Ptr looper)
+{
+    std::vector<TimerHandle> handles(TIMER_COUNT);
+    int64_t armNs = 0, cancelNs = 0;
+    looper->wait([&handles, &armNs, &cancelNs, looper]() {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> delay(100, MAX_DELAY_MS); //past the arming loop itself
+        auto start = steady_clock::now();
+        for (int i = 0; i < TIMER_COUNT; i++) {
+            auto deadline = steady_clock::now() + milliseconds(delay(rng));
+            handles[i] = looper->dispatchAt(deadline, [deadline]() { onFire(deadline); });
+        }
+        auto armed = steady_clock::now();
+        for (int i = 0; i < TIMER_COUNT; i += 2) handles[i].cancel();
+        auto cancelled = steady_clock::now();
+        armNs = duration_cast<nanoseconds>(armed - start).count();
+        cancelNs = duration_cast<nanoseconds>(cancelled - armed).count();
+    });
+    std::cout << "armed " << TIMER_COUNT << " timers: " << armNs / TIMER_COUNT << " ns each, cancelled half: "
+        << cancelNs / (TIMER_COUNT / 2) << " ns each" << std::endl;
+    std::this_thread::sleep_for(milliseconds(MAX_DELAY_MS + 200));
+    waitFor(fired, TIMER_COUNT / 2, milliseconds(5000));
+    std::cout << "fired " << fired << " of " << TIMER_COUNT / 2 << ", early " << early
+        << ", max late " << maxLateUs / 1000.0 << " ms" << std::endl;
+    //the cancelled half must not run either
+    std::this_thread::sleep_for(milliseconds(50));
+    return fired == TIMER_COUNT / 2 && early == 0;
+}
+
+static bool periodic(Looper<int64_t>::Ptr looper)
+{
+    std::atomic<int> runs(0);
+    TimerHandle every = looper->dispatchEvery(milliseconds(10), [&runs]() { runs += 1; });
+    std::this_thread::sleep_for(milliseconds(205));
+    every.cancel();
+    int atCancel = runs.load();
+    std::this_thread::sleep_for(milliseconds(50));
+    std::cout << "every 10 ms for 205 ms: " << atCancel << " runs, " << runs - atCancel << " after cancel" << std::endl;
+    //never ahead of the period; one run may have been under way while cancelling
+    return atCancel > 0 && atCancel <= 20 && runs - atCancel <= 1;
+}
+
+static bool crossThreadCancel(Looper<int64_t>::Ptr looper)
+{
+    std::atomic<int> runs(0);
+    std::vector<TimerHandle> handles;
+    for (int i = 0; i < 1000; i++) {
+        handles.push_back(looper->dispatchAfter(milliseconds(20), [&runs]() { runs += 1; }));
+    }
+    int cancelled = 0;
+    for (size_t i = 0; i < handles.size(); i += 2) cancelled += handles[i].cancel() ? 1 : 0;
+    std::this_thread::sleep_for(milliseconds(100));
+    waitFor(runs, 1000 - cancelled, milliseconds(5000));
+    std::this_thread::sleep_for(milliseconds(50));
+    std::cout << "cancelled " << cancelled << " of 1000 from another thread, " << runs << " ran" << std::endl;
+    return cancelled > 0 && runs == 1000 - cancelled;
+}
+
+int main(int argc, char **argv)
+{
+    IdleLoop loop;
+    auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::NET_THREAD, &loop, 1000);
+    looper->run();
+
+    bool ok = scale(looper);
+    ok = periodic(looper) && ok;
+    ok = crossThreadCancel(looper) && ok;
+
+    looper->syncStop();
+    looper->join();
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "TripleBuffer.h"
+
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+
+#include <thread>
+
+#define WRITE_MS 1000
+#define FIELDS 64
+
+using namespace std::chrono;
+using namespace cocos2d::loop;
+
+// every field carries the version, a torn read would mix two of them
+struct Snapshot {
+    int64_t version = 0;
+    int64_t fields[FIELDS] = {};
+};
+
+struct ReadCheck {
+    int64_t frames = 0;
+    int64_t torn = 0;
+    int64_t backwards = 0;
+    int64_t last = 0;
+
+    void check(const Snapshot &s)
+    {
+        for (int i = 0; i < FIELDS; i++) {
+            if (s.fields[i] != s.version) {
+                torn += 1;
+                break;
+            }
+        }
+        if (s.version < last) backwards += 1;
+        last = s.version;
+        frames += 1;
+    }
+};
+
+// renderer that polls the newest snapshot every update
+class RenderLoop : public Loop {
+public:
+    explicit RenderLoop(TripleBuffer<Snapshot> &buf) : buf(buf) {}
+    void update(int64_t dtUs) override
+    {
+        if (buf.fetch()) check.check(buf.read());
+    }
+    TripleBuffer<Snapshot> &buf;
+    ReadCheck check;
+};
+
+std::atomic<bool> writing(true);
+
+static void writer(TripleBuffer<Snapshot> *buf)
+{
+    int64_t version = 0;
+    while (writing.load()) {
+        Snapshot &s = buf->writeBuffer();
+        version += 1;
+        s.version = version;
+        for (int i = 0; i < FIELDS; i++) s.fields[i] = version;
+        buf->publish();
+        if (version % 64 == 0) std::this_thread::yield();
+    }
+}
+
+static bool report(const char *title, const ReadCheck &check, const TripleBuffer<Snapshot> &buf)
+{
+    std::cout << title << ": published " << buf.published() << ", read " << check.frames << ", torn " << check.torn
+        << ", out of order " << check.backwards << std::endl;
+    return check.frames > 0 && check.torn == 0 && check.backwards == 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = true;
+    {
+        TripleBuffer<Snapshot> buf;
+        RenderLoop render(buf);
+        auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::RENDER_THREAD, &render, 1000);
+        looper->setUpdateInterval(1000.0 / 60);
+        looper->run();
+        writing = true;
+        std::thread w(writer, &buf);
+        std::this_thread::sleep_for(milliseconds(WRITE_MS));
+        writing = false;
+        w.join();
+        looper->syncStop();
+        looper->join();
+        ok = report("poll 60 Hz", render.check, buf) && ok;
+    }
+    {
+        TripleBuffer<Snapshot> buf;
+        ReadCheck check;
+        auto looper = std::make_shared<Looper<int64_t>>(ThreadCategory::RENDER_THREAD, nullptr, 1000);
+        buf.wakeOnPublish(looper, [&check](const Snapshot &s) { check.check(s); });
+        looper->run();
+        writing = true;
+        std::thread w(writer, &buf);
+        std::this_thread::sleep_for(milliseconds(WRITE_MS));
+        writing = false;
+        w.join();
+        looper->syncStop();
+        looper->join();
+        ok = report("wake      ", check, buf) && ok;
+        std::cout << "           reader wakeups " << looper->getDrainStats().wakeups << std::endl;
+    }
+
+#ifdef _WIN32
+    system("pause");
+#endif
+
+    return ok ? 0 : 1;
+}
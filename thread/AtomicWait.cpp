@@ -0,0 +1,87 @@
+#include "AtomicWait.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#include <cerrno>
+#include <climits>
+#else
+#include <thread>
+#include <chrono>
+#endif
+
+namespace cocos2d
+{
+    namespace loop
+    {
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic word must be lock free and plain sized");
+
+#if defined(_WIN32)
+
+        bool AtomicWait::wait(std::atomic<uint32_t> &addr, uint32_t old, int64_t timeoutUs)
+        {
+            DWORD ms = timeoutUs < 0 ? INFINITE : (DWORD)((timeoutUs + 999) / 1000);
+            if (WaitOnAddress(&addr, &old, sizeof(old), ms)) return true;
+            return GetLastError() != ERROR_TIMEOUT;
+        }
+
+        void AtomicWait::wakeOne(std::atomic<uint32_t> &addr)
+        {
+            WakeByAddressSingle(&addr);
+        }
+
+        void AtomicWait::wakeAll(std::atomic<uint32_t> &addr)
+        {
+            WakeByAddressAll(&addr);
+        }
+
+#elif defined(__linux__)
+
+        bool AtomicWait::wait(std::atomic<uint32_t> &addr, uint32_t old, int64_t timeoutUs)
+        {
+            struct timespec ts;
+            struct timespec *pts = nullptr;
+            if (timeoutUs >= 0) {
+                ts.tv_sec = (time_t)(timeoutUs / 1000000);
+                ts.tv_nsec = (long)(timeoutUs % 1000000) * 1000;
+                pts = &ts;
+            }
+            long r = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&addr), FUTEX_WAIT_PRIVATE, old, pts, nullptr, 0);
+            return !(r == -1 && errno == ETIMEDOUT);
+        }
+
+        void AtomicWait::wakeOne(std::atomic<uint32_t> &addr)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&addr), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+
+        void AtomicWait::wakeAll(std::atomic<uint32_t> &addr)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&addr), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+#else
+
+        bool AtomicWait::wait(std::atomic<uint32_t> &addr, uint32_t old, int64_t timeoutUs)
+        {
+            using namespace std::chrono;
+            auto deadline = steady_clock::now() + microseconds(timeoutUs < 0 ? 0 : timeoutUs);
+            while (addr.load(std::memory_order_acquire) == old)
+            {
+                if (timeoutUs >= 0 && steady_clock::now() >= deadline) return false;
+                std::this_thread::sleep_for(microseconds(50));
+            }
+            return true;
+        }
+
+        void AtomicWait::wakeOne(std::atomic<uint32_t> &addr) {}
+
+        void AtomicWait::wakeAll(std::atomic<uint32_t> &addr) {}
+
+#endif
+    }
+}
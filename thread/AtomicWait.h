@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CC_LOOP_CPU_PAUSE() _mm_pause()
+#else
+#define CC_LOOP_CPU_PAUSE() ((void)0)
+#endif
+
+namespace cocos2d
+{
+    namespace loop
+    {
+        // block on a 32 bit atomic word without a mutex/condition_variable pair.
+        // futex on linux, WaitOnAddress on win32, polling elsewhere.
+        class AtomicWait {
+        public:
+            //sleep while addr == old, false if timeoutUs (>= 0) expired. may wake spuriously
+            static bool wait(std::atomic<uint32_t> &addr, uint32_t old, int64_t timeoutUs = -1);
+            static void wakeOne(std::atomic<uint32_t> &addr);
+            static void wakeAll(std::atomic<uint32_t> &addr);
+            //spin loop hint
+            static void pause() { CC_LOOP_CPU_PAUSE(); }
+        };
+    }
+}
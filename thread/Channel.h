@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+
+#include "EventId.h"
+#include "MailItem.h"
+#include "Collections.h"
+#include "UniqueFunction.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // typed event key, the payload type is part of the channel instead of the Looper.
+        // like EventId the name is interned once, usually into a static:
+        //   static const Channel<NetPacket> PACKETS("net.packet");
+        //   looper->on(PACKETS, [](NetPacket &p) { ... });
+        //   looper->emit(PACKETS, NetPacket(...));
+        template<typename T>
+        class Channel {
+        public:
+            typedef T Type;
+            typedef UniqueFunction<void(T&)> Handler;
+            explicit Channel(const std::string &name) : _id(EventId::of(name)) {}
+            EventId id() const { return _id; }
+            const std::string &name() const { return _id.name(); }
+        private:
+            EventId _id;
+        };
+
+        //dense index per payload type, assigned on first use, without rtti
+        class ChannelTypeIndex {
+        public:
+            template<typename T>
+            static size_t of() { static const size_t idx = next(); return idx; }
+        private:
+            static size_t next() { static std::atomic<size_t> count(0); return count.fetch_add(1); }
+        };
+
+        struct ChannelTableBase {
+            virtual ~ChannelTableBase() {}
+        };
+
+        //the handlers of every Channel<T> on one Looper, indexed by the EventId of the channel.
+        //one table per payload type, so a name reused with another type never reaches them.
+        //the lists are copied on every change and a Handler is move only, so they share it
+        template<typename T>
+        struct ChannelTable : ChannelTableBase {
+            typedef std::shared_ptr<typename Channel<T>::Handler> HandlerPtr;
+            CowIndexArray<HandlerPtr> handlers;
+        };
+
+        template<typename T>
+        struct ChannelPayload : ChannelItem {
+            template<typename ...Args>
+            ChannelPayload(DeliverF deliver, EventId id, Args&&... args) : ChannelItem(deliver), id(id), data(std::forward<Args>(args)...) {}
+            EventId id;
+            T data;
+        };
+
+    }
+}
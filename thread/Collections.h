@@ -4,9 +4,12 @@
 #include <vector>
 #include <unordered_map>
 #include <functional>
+#include <memory>
 
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 
 #include <cassert>
 
@@ -105,6 +108,120 @@ namespace cocos2d
             std::recursive_mutex _mtx;
         };
 
+        // vectors of values addressed by a dense index (e.g. EventId::index()),
+        // published as immutable snapshots (copy on write).
+        // add()/clear() are rare writers serialized by a mutex. The single reader thread
+        // iterates inside a ReadGuard without any lock. Replaced snapshots are freed by
+        // later writers once the reader has left every section that could still see them.
+        // the lists are immutable and shared between snapshots, an index never added to is a
+        // null entry, so one high index does not allocate lists for the whole prefix.
+        template<typename V>
+        class CowIndexArray {
+        public:
+            typedef std::vector<V> List;
+            typedef std::vector<std::shared_ptr<const List> > Snapshot;
+
+            class ReadGuard {
+            public:
+                ReadGuard(CowIndexArray &arr) : _arr(arr), _snap(arr.enterRead()) {}
+                ~ReadGuard() { _arr.leaveRead(); }
+                const Snapshot *operator->() const { return _snap; }
+                const Snapshot &operator*() const { return *_snap; }
+            private:
+                CowIndexArray &_arr;
+                const Snapshot *_snap;
+            };
+
+            CowIndexArray() : _current(new Snapshot()) {}
+            ~CowIndexArray()
+            {
+                delete _current.load();
+                for (auto &r : _retired) delete r.second;
+            }
+
+            void add(size_t idx, const V &value)
+            {
+                _TMP_CC_LOOP_TS_LOCK;
+                Snapshot *next = new Snapshot(*_current.load());
+                if (idx >= next->size()) next->resize(idx + 1);
+                std::shared_ptr<List> list = (*next)[idx] ? std::make_shared<List>(*(*next)[idx]) : std::make_shared<List>();
+                list->push_back(value);
+                (*next)[idx] = list;
+                publish(next);
+            }
+
+            void clear(size_t idx)
+            {
+                _TMP_CC_LOOP_TS_LOCK;
+                const Snapshot *cur = _current.load();
+                if (idx >= cur->size() || !(*cur)[idx]) return;
+                Snapshot *next = new Snapshot(*cur);
+                (*next)[idx].reset();
+                publish(next);
+            }
+
+            //reader thread only, the snapshot stays valid until the guard is gone
+            template<typename Fn>
+            void forEach(size_t idx, Fn &&iterFn)
+            {
+                ReadGuard snap(*this);
+                if (idx >= snap->size() || !(*snap)[idx]) return;
+                const List &list = *(*snap)[idx];
+                for (auto m = list.begin(); m != list.end(); m++)
+                {
+                    iterFn(*m);
+                }
+            }
+
+            std::recursive_mutex& getMutex() { return _mtx; }
+        private:
+            static const uint64_t QUIESCENT = UINT64_MAX;
+
+            const Snapshot *enterRead()
+            {
+                if (_readDepth++ == 0) {
+                    _readerEpoch.store(_epoch.load());
+                }
+                return _current.load();
+            }
+
+            void leaveRead()
+            {
+                assert(_readDepth > 0);
+                if (--_readDepth == 0) {
+                    _readerEpoch.store(QUIESCENT);
+                }
+            }
+
+            //called with _mtx held
+            void publish(Snapshot *next)
+            {
+                Snapshot *old = _current.exchange(next);
+                uint64_t epoch = _epoch.fetch_add(1);
+                _retired.push_back(std::make_pair(epoch, old));
+
+                uint64_t reader = _readerEpoch.load();
+                for (auto it = _retired.begin(); it != _retired.end();)
+                {
+                    //a section started after the replacement can not see the old snapshot
+                    if (reader == QUIESCENT || reader > it->first) {
+                        delete it->second;
+                        it = _retired.erase(it);
+                    }
+                    else {
+                        it++;
+                    }
+                }
+            }
+
+            std::atomic<Snapshot*> _current;
+            std::atomic<uint64_t> _epoch{ 0 };
+            std::atomic<uint64_t> _readerEpoch{ QUIESCENT };
+            int _readDepth = 0; //reader thread only
+            std::vector<std::pair<uint64_t, Snapshot*> > _retired;
+            std::recursive_mutex _mtx;
+        };
+
     }
 }
 
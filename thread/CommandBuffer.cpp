@@ -0,0 +1,78 @@
+#include "CommandBuffer.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        CommandBuffer::CommandBuffer(size_t blockSize) : _blockSize(alignUp(blockSize > 0 ? blockSize : ALIGN))
+        {}
+
+        CommandBuffer::~CommandBuffer()
+        {
+            clear();
+        }
+
+        size_t CommandBuffer::capacity() const
+        {
+            size_t total = 0;
+            for (auto &b : _blocks) total += b.size;
+            return total;
+        }
+
+        //header and command, in the current block or the next one that fits
+        void *CommandBuffer::allocate(size_t cmdSize)
+        {
+            size_t need = alignUp(sizeof(Header)) + alignUp(cmdSize);
+            while (_current < _blocks.size() && _blocks[_current].size - _blocks[_current].used < need)
+            {
+                _current += 1;
+            }
+            if (_current == _blocks.size())
+            {
+                Block b;
+                b.size = need > _blockSize ? need : _blockSize;
+                b.data.reset(new unsigned char[b.size]);
+                _blocks.push_back(std::move(b));
+            }
+            Block &b = _blocks[_current];
+            void *mem = b.data.get() + b.used;
+            b.used += need;
+            static_cast<Header*>(mem)->next = (uint32_t)b.used;
+            _count += 1;
+            _bytes += need;
+            return mem;
+        }
+
+        void CommandBuffer::replay()
+        {
+            rewind(true);
+        }
+
+        void CommandBuffer::clear()
+        {
+            rewind(false);
+        }
+
+        void CommandBuffer::rewind(bool execute)
+        {
+            //blocks skipped because a command did not fit were left partly empty, used tells where they end
+            for (size_t i = 0; i < _blocks.size() && i <= _current; i++)
+            {
+                Block &b = _blocks[i];
+                size_t at = 0;
+                while (at < b.used)
+                {
+                    Header *h = reinterpret_cast<Header*>(b.data.get() + at);
+                    h->run(b.data.get() + at + alignUp(sizeof(Header)), execute);
+                    at = h->next;
+                }
+                b.used = 0;
+            }
+            _current = 0;
+            _count = 0;
+            _bytes = 0;
+        }
+
+    }
+}
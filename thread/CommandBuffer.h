@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // variable sized commands recorded back to back into reusable memory blocks.
+        // a command is any callable, stored inline after a small header; replay() runs
+        // and destroys them in record order, then rewinds. The blocks are kept, so once
+        // a frame's worth of commands fit, recording allocates nothing.
+        // single threaded, see CommandChannel for passing buffers between Loopers
+        class CommandBuffer {
+        public:
+            explicit CommandBuffer(size_t blockSize = 64 * 1024);
+            ~CommandBuffer();
+            CommandBuffer(const CommandBuffer &) = delete;
+            CommandBuffer &operator=(const CommandBuffer &) = delete;
+
+            template<typename F>
+            void record(F &&fn);
+            //runs every command in record order, then rewinds
+            void replay();
+            //destroys the commands without running them
+            void clear();
+
+            size_t size() const { return _count; }
+            bool empty() const { return _count == 0; }
+            size_t bytes() const { return _bytes; }           //recorded since the last rewind
+            size_t capacity() const;
+
+        private:
+            typedef void(*RunF)(void *cmd, bool execute);
+            struct Header {
+                RunF run;
+                uint32_t next;      //offset of the next header in the block
+            };
+            struct Block {
+                std::unique_ptr<unsigned char[]> data;
+                size_t size = 0;
+                size_t used = 0;
+            };
+
+            static const size_t ALIGN = alignof(std::max_align_t);
+
+            template<typename F>
+            static void run(void *cmd, bool execute);
+            static size_t alignUp(size_t n) { return (n + ALIGN - 1) & ~(ALIGN - 1); }
+            void *allocate(size_t cmdSize);
+            void rewind(bool execute);
+
+            size_t _blockSize;
+            std::vector<Block> _blocks;
+            size_t _current = 0;    //block being recorded into
+            size_t _count = 0;
+            size_t _bytes = 0;
+        };
+
+
+        template<typename F>
+        void CommandBuffer::record(F &&fn)
+        {
+            typedef typename std::decay<F>::type Cmd;
+            static_assert(alignof(Cmd) <= ALIGN, "over aligned commands are not supported");
+            void *mem = allocate(sizeof(Cmd));
+            Header *h = static_cast<Header*>(mem);
+            h->run = &CommandBuffer::run<Cmd>;
+            new (static_cast<unsigned char*>(mem) + alignUp(sizeof(Header))) Cmd(std::forward<F>(fn));
+        }
+
+        template<typename F>
+        void CommandBuffer::run(void *cmd, bool execute)
+        {
+            F *fn = static_cast<F*>(cmd);
+            if (execute) (*fn)();
+            fn->~F();
+        }
+
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cassert>
+
+#include "Looper.h"
+#include "CommandBuffer.h"
+#include "AtomicWait.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // single producer, single consumer command stream into one Looper, e.g. physics to render.
+        // the producer records a frame into a CommandBuffer and submit()s it as one mailbox
+        // item; the consumer replays it in order and hands the buffer back. The buffers and
+        // their mailbox items are reused round robin, so a frame costs one wakeup and, once
+        // the arenas have grown to a frame's size, no allocation.
+        // all buffers in flight means the consumer is frames behind: record() waits for one.
+        // every frame goes through the one mailbox lane picked at construction: lanes are
+        // drained by priority, so frames on different lanes would be replayed out of order.
+        // destroy the channel after flush() or after the consumer Looper stopped.
+        template<typename LoopEvent>
+        class CommandChannel {
+        public:
+            typedef std::shared_ptr<Looper<LoopEvent> > LooperPtr;
+
+            struct Stats {
+                uint64_t frames = 0;        //submitted batches
+                uint64_t commands = 0;
+                uint64_t stalls = 0;        //record() calls that waited for a buffer
+            };
+
+            CommandChannel(LooperPtr consumer, size_t buffers = 3, size_t blockSize = 64 * 1024,
+                MailPriority prio = MailPriority::NORMAL);
+
+            //producer thread
+            template<typename F>
+            void record(F &&fn) { acquire().record(std::forward<F>(fn)); }
+            //queues the recorded frame, empty frames are not sent
+            void submit();
+            //waits until the consumer replayed everything submitted
+            void flush();
+
+            Stats getStats() const;
+
+        private:
+            struct Slot : ExternalItem {
+                Slot(CommandChannel *owner, size_t blockSize) : ExternalItem(&Slot::run), owner(owner), buffer(blockSize) {}
+                static void run(ExternalItem *item)
+                {
+                    Slot *slot = static_cast<Slot*>(item);
+                    slot->buffer.replay();
+                    slot->owner->release();
+                }
+                CommandChannel *owner;
+                CommandBuffer buffer;
+            };
+
+            CommandBuffer &acquire();
+            void release();
+            void waitReturned(uint32_t atLeast);
+
+            LooperPtr _consumer;
+            MailPriority _prio;
+            std::vector<std::unique_ptr<Slot> > _slots;
+            //producer only
+            uint32_t _submitted = 0;
+            bool _recording = false;
+            std::atomic<uint64_t> _frames{ 0 };
+            std::atomic<uint64_t> _commands{ 0 };
+            std::atomic<uint64_t> _stalls{ 0 };
+            //consumer side, buffers are replayed and returned in submit order
+            std::atomic<uint32_t> _returned{ 0 };
+            std::atomic<uint32_t> _waiting{ 0 };
+        };
+
+
+        template<typename LoopEvent>
+        CommandChannel<LoopEvent>::CommandChannel(LooperPtr consumer, size_t buffers, size_t blockSize, MailPriority prio) :
+            _consumer(std::move(consumer)), _prio(prio)
+        {
+            assert(_consumer);
+            if (buffers < 1) buffers = 1;
+            for (size_t i = 0; i < buffers; i++)
+            {
+                _slots.push_back(std::unique_ptr<Slot>(new Slot(this, blockSize)));
+            }
+        }
+
+        template<typename LoopEvent>
+        CommandBuffer &CommandChannel<LoopEvent>::acquire()
+        {
+            Slot &slot = *_slots[_submitted % _slots.size()];
+            if (!_recording)
+            {
+                //the slot for this frame is still queued or replaying
+                uint32_t needed = _submitted - (uint32_t)_slots.size() + 1;
+                if ((int32_t)(_returned.load() - needed) < 0)
+                {
+                    _stalls.store(_stalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    waitReturned(needed);
+                }
+                _recording = true;
+            }
+            return slot.buffer;
+        }
+
+        template<typename LoopEvent>
+        void CommandChannel<LoopEvent>::submit()
+        {
+            if (!_recording) return;
+            _recording = false;
+            Slot &slot = *_slots[_submitted % _slots.size()];
+            if (slot.buffer.empty()) return;
+            _frames.store(_frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            _commands.store(_commands.load(std::memory_order_relaxed) + slot.buffer.size(), std::memory_order_relaxed);
+            _submitted += 1;
+            _consumer->postExternal(&slot, _prio);
+        }
+
+        template<typename LoopEvent>
+        void CommandChannel<LoopEvent>::flush()
+        {
+            if (_consumer->isCurrentThread())
+            {
+                //the frames are queued behind us on this thread, a nested drain replays them
+                _consumer->wait([]() {});
+                return;
+            }
+            waitReturned(_submitted);
+        }
+
+        //consumer thread, after the replay
+        template<typename LoopEvent>
+        void CommandChannel<LoopEvent>::release()
+        {
+            _returned.fetch_add(1);
+            if (_waiting.load() != 0) AtomicWait::wakeAll(_returned);
+        }
+
+        template<typename LoopEvent>
+        void CommandChannel<LoopEvent>::waitReturned(uint32_t atLeast)
+        {
+            _waiting.fetch_add(1);
+            while (true)
+            {
+                uint32_t seen = _returned.load();
+                if ((int32_t)(seen - atLeast) >= 0) break;
+                AtomicWait::wait(_returned, seen, 1000);
+            }
+            _waiting.fetch_sub(1);
+        }
+
+        template<typename LoopEvent>
+        typename CommandChannel<LoopEvent>::Stats CommandChannel<LoopEvent>::getStats() const
+        {
+            Stats st;
+            st.frames = _frames.load(std::memory_order_relaxed);
+            st.commands = _commands.load(std::memory_order_relaxed);
+            st.stalls = _stalls.load(std::memory_order_relaxed);
+            return st;
+        }
+
+    }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+// C++20 coroutine support, compiled only when the compiler implements coroutines.
+// define CC_LOOP_NO_COROUTINES to keep it off.
+#if defined(__cpp_impl_coroutine) && !defined(CC_LOOP_NO_COROUTINES)
+#define CC_LOOP_COROUTINES 1
+#endif
+
+#ifdef CC_LOOP_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <cassert>
+
+#include "MailItem.h"
+#include "Future.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // the Looper owning the current thread, seen only through its ExternalItem entry.
+        // set by Looper::init(), empty on threads without a Looper
+        struct LooperResumer {
+            void *looper = nullptr;
+            void(*post)(void *looper, ExternalItem *item) = nullptr;
+
+            static LooperResumer &current()
+            {
+                static thread_local LooperResumer resumer;
+                return resumer;
+            }
+        };
+
+        template<typename T>
+        class Task;
+
+        struct TaskPromiseBase {
+            struct FinalAwaiter {
+                bool await_ready() const noexcept { return false; }
+                template<typename P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+                {
+                    auto &p = h.promise();
+                    if (p.continuation) return p.continuation;
+                    if (p.detached) h.destroy();
+                    return std::noop_coroutine();
+                }
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            void unhandled_exception() { std::terminate(); }
+
+            std::coroutine_handle<> continuation;
+            bool detached = false;
+        };
+
+        template<typename T>
+        struct TaskPromise : TaskPromiseBase {
+            Task<T> get_return_object();
+            template<typename U>
+            void return_value(U &&v) { value.set(std::forward<U>(v)); }
+            FutureValue<T> value;
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase {
+            Task<void> get_return_object();
+            void return_void() { value.set(); }
+            FutureValue<void> value;
+        };
+
+        // lazily started coroutine. co_await it from another coroutine, or detach()
+        // a top level flow whose frame frees itself when it finishes.
+        template<typename T = void>
+        class Task {
+        public:
+            typedef TaskPromise<T> promise_type;
+            typedef std::coroutine_handle<promise_type> Handle;
+
+            explicit Task(Handle h) : _handle(h) {}
+            Task(Task &&o) noexcept : _handle(std::exchange(o._handle, nullptr)) {}
+            Task(const Task &) = delete;
+            ~Task() { if (_handle) _handle.destroy(); }
+
+            void detach()
+            {
+                assert(_handle);
+                Handle h = std::exchange(_handle, nullptr);
+                h.promise().detached = true;
+                h.resume();
+            }
+
+            auto operator co_await() && noexcept
+            {
+                struct Awaiter {
+                    bool await_ready() const noexcept { return false; }
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept
+                    {
+                        handle.promise().continuation = c;
+                        return handle;
+                    }
+                    T await_resume() { return handle.promise().value.take(); }
+                    Handle handle;
+                };
+                assert(_handle);
+                return Awaiter{ _handle };
+            }
+
+        private:
+            Handle _handle;
+        };
+
+        template<typename T>
+        inline Task<T> TaskPromise<T>::get_return_object()
+        {
+            return Task<T>(Task<T>::Handle::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object()
+        {
+            return Task<void>(Task<void>::Handle::from_promise(*this));
+        }
+
+        // co_await looper->schedule(): resume on the looper thread. The awaiter lives in
+        // the coroutine frame and is itself the mailbox entry, so hopping allocates nothing.
+        template<typename L>
+        class ScheduleAwaiter : public ExternalItem {
+        public:
+            explicit ScheduleAwaiter(L *looper) : ExternalItem(&ScheduleAwaiter::resume), _looper(looper) {}
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                _handle = h;
+                _looper->postExternal(this);
+            }
+            void await_resume() const noexcept {}
+        private:
+            static void resume(ExternalItem *item) { static_cast<ScheduleAwaiter*>(item)->_handle.resume(); }
+            L *_looper;
+            std::coroutine_handle<> _handle;
+        };
+
+        // co_await future: resume on the Looper that was running the coroutine when it
+        // suspended, or inline on the completing thread if there was none.
+        template<typename T>
+        class FutureAwaiter : public ExternalItem {
+        public:
+            explicit FutureAwaiter(Future<T> &&f) : ExternalItem(&FutureAwaiter::resume), _future(std::move(f)) {}
+            bool await_ready() const { return _future.ready(); }
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                _handle = h;
+                _resumer = LooperResumer::current();
+                _future.onReady(Hop{ this });
+            }
+            T await_resume() { return _future.get(); }
+        private:
+            struct Hop {
+                void operator()()
+                {
+                    if (self->_resumer.post) self->_resumer.post(self->_resumer.looper, self);
+                    else self->_handle.resume();
+                }
+                FutureAwaiter *self;
+            };
+            static void resume(ExternalItem *item) { static_cast<FutureAwaiter*>(item)->_handle.resume(); }
+            Future<T> _future;
+            std::coroutine_handle<> _handle;
+            LooperResumer _resumer;
+        };
+
+        template<typename T>
+        FutureAwaiter<T> operator co_await(Future<T> f)
+        {
+            return FutureAwaiter<T>(std::move(f));
+        }
+
+    }
+}
+
+#endif // CC_LOOP_COROUTINES
@@ -0,0 +1,65 @@
+#include "EventId.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace cocos2d
+{
+    namespace loop
+    {
+        static std::mutex &registryMutex()
+        {
+            static std::mutex mtx;
+            return mtx;
+        }
+
+        static std::unordered_map<std::string, uint32_t> &registryIndex()
+        {
+            static std::unordered_map<std::string, uint32_t> index;
+            return index;
+        }
+
+        //deque keeps references returned by name() stable
+        static std::deque<std::string> &registryNames()
+        {
+            static std::deque<std::string> names;
+            return names;
+        }
+
+        EventId EventId::of(const std::string &name)
+        {
+            std::lock_guard<std::mutex> guard(registryMutex());
+            auto &index = registryIndex();
+            auto it = index.find(name);
+            if (it != index.end()) return EventId(it->second);
+            auto &names = registryNames();
+            uint32_t idx = (uint32_t)names.size();
+            names.push_back(name);
+            index.insert(std::make_pair(name, idx));
+            return EventId(idx);
+        }
+
+        EventId EventId::find(const std::string &name)
+        {
+            std::lock_guard<std::mutex> guard(registryMutex());
+            auto &index = registryIndex();
+            auto it = index.find(name);
+            return it == index.end() ? EventId() : EventId(it->second);
+        }
+
+        uint32_t EventId::count()
+        {
+            std::lock_guard<std::mutex> guard(registryMutex());
+            return (uint32_t)registryNames().size();
+        }
+
+        const std::string & EventId::name() const
+        {
+            static const std::string invalid("[invalid]");
+            if (!valid()) return invalid;
+            std::lock_guard<std::mutex> guard(registryMutex());
+            return registryNames()[_index];
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // handle of an interned event name.
+        // names are registered once (usually into a static), after that routing an
+        // event is a direct index into the handler table of the Looper
+        class EventId {
+        public:
+            static const uint32_t INVALID_INDEX = UINT32_MAX;
+
+            EventId() {}
+
+            static EventId of(const std::string &name);   //register if missing
+            static EventId find(const std::string &name); //invalid if never registered
+            static uint32_t count();
+
+            bool valid() const { return _index != INVALID_INDEX; }
+            uint32_t index() const { return _index; }
+            const std::string &name() const;
+
+            bool operator==(const EventId &o) const { return _index == o._index; }
+            bool operator!=(const EventId &o) const { return _index != o._index; }
+        private:
+            explicit EventId(uint32_t idx) : _index(idx) {}
+            uint32_t _index = INVALID_INDEX;
+        };
+
+    }
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <utility>
+#include <type_traits>
+#include <new>
+#include <cassert>
+#include <cstdint>
+
+#include "AtomicWait.h"
+#include "UniqueFunction.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        template<typename T>
+        class Future;
+
+        template<typename T>
+        class FutureValue {
+        public:
+            FutureValue() {}
+            ~FutureValue() { if (_has) ptr()->~T(); }
+            template<typename ...Args>
+            void set(Args&&... args)
+            {
+                new (&_storage) T(std::forward<Args>(args)...);
+                _has = true;
+            }
+            T take() { return std::move(*ptr()); }
+        private:
+            T *ptr() { return reinterpret_cast<T*>(&_storage); }
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+            bool _has = false;
+        };
+
+        template<>
+        class FutureValue<void> {
+        public:
+            void set() {}
+            void take() {}
+        };
+
+        // state shared by a Future and its producer. The value is set once; the
+        // consumer either blocks in get() (futex/WaitOnAddress on the flag word,
+        // no syscall when nobody waits) or registers one continuation with then().
+        template<typename T>
+        class FutureState {
+        public:
+            enum : uint32_t {
+                READY = 1 << 0,
+                CONTINUED = 1 << 1,
+                WAITING = 1 << 2,
+            };
+
+            template<typename ...Args>
+            void setValue(Args&&... args)
+            {
+                _value.set(std::forward<Args>(args)...);
+                uint32_t prev = _flags.fetch_or(READY, std::memory_order_acq_rel);
+                assert(!(prev & READY));
+                if (prev & CONTINUED) _cont();
+                if (prev & WAITING) AtomicWait::wakeAll(_flags);
+            }
+
+            void setContinuation(UniqueFunction<void()> &&cont)
+            {
+                _cont = std::move(cont);
+                uint32_t prev = _flags.fetch_or(CONTINUED, std::memory_order_acq_rel);
+                assert(!(prev & CONTINUED));
+                if (prev & READY) _cont();
+            }
+
+            bool ready() const { return (_flags.load(std::memory_order_acquire) & READY) != 0; }
+
+            //timeoutUs < 0 waits forever, false on timeout
+            bool wait(int64_t timeoutUs)
+            {
+                using namespace std::chrono;
+                uint32_t f = _flags.load(std::memory_order_acquire);
+                if (f & READY) return true;
+                auto deadline = steady_clock::now() + microseconds(timeoutUs < 0 ? 0 : timeoutUs);
+                while (!(f & READY))
+                {
+                    if (!(f & WAITING)) {
+                        f = _flags.fetch_or(WAITING, std::memory_order_acq_rel) | WAITING;
+                        continue;
+                    }
+                    int64_t left = -1;
+                    if (timeoutUs >= 0) {
+                        left = duration_cast<microseconds>(deadline - steady_clock::now()).count();
+                        if (left <= 0) return false;
+                    }
+                    AtomicWait::wait(_flags, f, left);
+                    f = _flags.load(std::memory_order_acquire);
+                }
+                return true;
+            }
+
+            T take() { return _value.take(); }
+
+        private:
+            std::atomic<uint32_t> _flags{ 0 };
+            FutureValue<T> _value;
+            UniqueFunction<void()> _cont;
+        };
+
+        template<typename T, typename F>
+        struct FutureResult {
+            typedef decltype(std::declval<F&>()(std::declval<T>())) type;
+        };
+
+        template<typename F>
+        struct FutureResult<void, F> {
+            typedef decltype(std::declval<F&>()()) type;
+        };
+
+        template<typename R>
+        struct FutureFulfil {
+            template<typename F, typename ...Args>
+            static void run(FutureState<R> &st, F &fn, Args&&... args) { st.setValue(fn(std::forward<Args>(args)...)); }
+        };
+
+        template<>
+        struct FutureFulfil<void> {
+            template<typename F, typename ...Args>
+            static void run(FutureState<void> &st, F &fn, Args&&... args)
+            {
+                fn(std::forward<Args>(args)...);
+                st.setValue();
+            }
+        };
+
+        //closure posted by Looper::submit()
+        template<typename R, typename F>
+        struct FutureTask {
+            FutureTask(const std::shared_ptr<FutureState<R> > &st, F &&fn) : state(st), fn(std::move(fn)) {}
+            void operator()() { FutureFulfil<R>::run(*state, fn); }
+            std::shared_ptr<FutureState<R> > state;
+            F fn;
+        };
+
+        template<typename T>
+        struct FutureThenCall {
+            template<typename R, typename F>
+            static void call(FutureState<T> &src, FutureState<R> &dst, F &fn) { FutureFulfil<R>::run(dst, fn, src.take()); }
+        };
+
+        template<>
+        struct FutureThenCall<void> {
+            template<typename R, typename F>
+            static void call(FutureState<void> &src, FutureState<R> &dst, F &fn) { FutureFulfil<R>::run(dst, fn); }
+        };
+
+        //continuation body, runs on the looper passed to then()
+        template<typename T, typename R, typename F>
+        struct FutureThenTask {
+            void operator()() { FutureThenCall<T>::call(*src, *dst, fn); }
+            std::shared_ptr<FutureState<T> > src;
+            std::shared_ptr<FutureState<R> > dst;
+            F fn;
+        };
+
+        //runs on the thread that sets the value and hops to the target looper
+        template<typename L, typename Task>
+        struct FutureSchedule {
+            void operator()() { looper->dispatch(std::move(task)); }
+            L looper;
+            Task task;
+        };
+
+        // result of Looper::submit(). get() blocks, then() never does: the continuation
+        // is dispatched to the given Looper (raw or shared pointer) once the value is set.
+        template<typename T>
+        class Future {
+        public:
+            typedef std::shared_ptr<FutureState<T> > StatePtr;
+
+            Future() {}
+            explicit Future(const StatePtr &st) : _state(st) {}
+
+            bool valid() const { return _state != nullptr; }
+            bool ready() const { assert(_state); return _state->ready(); }
+
+            void wait() { assert(_state); _state->wait(-1); }
+
+            template<typename Rep, typename Period>
+            bool waitFor(const std::chrono::duration<Rep, Period> &timeout)
+            {
+                assert(_state);
+                return _state->wait(std::chrono::duration_cast<std::chrono::microseconds>(timeout).count());
+            }
+
+            //moves the value out, call once
+            T get()
+            {
+                wait();
+                return _state->take();
+            }
+
+            //fn runs on the thread that sets the value, or right away if it is set
+            template<typename F>
+            void onReady(F fn)
+            {
+                assert(_state);
+                _state->setContinuation(std::move(fn));
+            }
+
+            template<typename L, typename F>
+            Future<typename FutureResult<T, F>::type> then(L looper, F cont)
+            {
+                typedef typename FutureResult<T, F>::type R;
+                typedef FutureThenTask<T, R, F> Task;
+                assert(_state);
+                std::shared_ptr<FutureState<R> > next = std::make_shared<FutureState<R> >();
+                Task task{ _state, next, std::move(cont) };
+                _state->setContinuation(FutureSchedule<L, Task>{ looper, std::move(task) });
+                return Future<R>(next);
+            }
+
+        private:
+            StatePtr _state;
+        };
+
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace cocos2d
 {
     namespace loop
@@ -8,7 +10,12 @@ namespace cocos2d
         class Loop {
         public:
             virtual void before() {}
-            virtual void update(int dtMS) = 0;
+            //dtUs is the time measured since the previous update, except for the nominal steps
+            //CATCH_UP and DROP report for late ticks and every FIXED_STEP step, see OverrunPolicy
+            virtual void update(int64_t dtUs) = 0;
+            //OverrunPolicy::FIXED_STEP only, after the steps of a tick. alpha in [0, 1) is
+            //the share of a step left in the accumulator, to blend the last two states
+            virtual void interpolate(double alpha) {}
             virtual void after() {}
         };
 
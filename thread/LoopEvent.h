@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <utility>
 namespace cocos2d
 {
     namespace loop
@@ -11,7 +12,7 @@ namespace cocos2d
             LoopEvent(const std::string &msg) :message(msg) {}
             LoopEvent(const std::string &msg, void *data) :message(msg), data(data) {}
             LoopEvent(const LoopEvent &e) :eventName(e.eventName), message(e.message), data(e.data) {}
-            LoopEvent(LoopEvent && e) : eventName(e.eventName), message(e.message), data(e.data) {
+            LoopEvent(LoopEvent && e) : eventName(std::move(e.eventName)), message(std::move(e.message)), data(e.data) {
                 e.data = nullptr;
             }
 
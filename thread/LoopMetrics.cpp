@@ -0,0 +1,99 @@
+#include "LoopMetrics.h"
+
+#include <chrono>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        static int highestBit(uint64_t v)
+        {
+#ifdef _MSC_VER
+            unsigned long idx;
+            _BitScanReverse64(&idx, v);
+            return (int)idx;
+#else
+            return 63 - __builtin_clzll(v);
+#endif
+        }
+
+        size_t ShardedCounter::shardIndex()
+        {
+            static std::atomic<size_t> nextShard(0);
+            static thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+            return shard;
+        }
+
+        uint64_t ShardedCounter::sum() const
+        {
+            uint64_t total = 0;
+            for (const Shard &s : _shards) total += s.value.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        LatencyHistogram::LatencyHistogram()
+        {
+            for (auto &b : _buckets) b.store(0, std::memory_order_relaxed);
+        }
+
+        size_t LatencyHistogram::bucketOf(uint64_t value)
+        {
+            if (value < SUB) return (size_t)value;
+            int shift = highestBit(value) - SUB_BITS;
+            return (size_t)(shift + 1) * SUB + (size_t)((value >> shift) - SUB);
+        }
+
+        uint64_t LatencyHistogram::lowerBound(size_t bucket)
+        {
+            if (bucket < SUB) return bucket;
+            size_t shift = bucket / SUB - 1;
+            return (uint64_t)(bucket % SUB + SUB) << shift;
+        }
+
+        HistogramSnapshot LatencyHistogram::snapshot() const
+        {
+            HistogramSnapshot snap;
+            snap.buckets.resize(BUCKETS);
+            uint64_t count = 0;
+            for (size_t i = 0; i < BUCKETS; i++)
+            {
+                snap.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+                count += snap.buckets[i];
+            }
+            snap.count = count;
+            snap.max = _max.load(std::memory_order_relaxed);
+            snap.mean = count ? (double)_sum.load(std::memory_order_relaxed) / count : 0.0;
+            return snap;
+        }
+
+        uint64_t HistogramSnapshot::percentile(double p) const
+        {
+            if (count == 0) return 0;
+            uint64_t rank = (uint64_t)(p * count);
+            if (rank >= count) rank = count - 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < buckets.size(); i++)
+            {
+                seen += buckets[i];
+                if (seen > rank)
+                {
+                    uint64_t v = LatencyHistogram::lowerBound(i);
+                    return v < max ? v : max;
+                }
+            }
+            return max;
+        }
+
+        int64_t metricsNowNs()
+        {
+            using namespace std::chrono;
+            return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+    }
+}
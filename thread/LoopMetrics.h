@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // counter incremented from many threads. Every thread adds into its own
+        // cache line, only reading sums the shards.
+        class ShardedCounter {
+        public:
+            void add(uint64_t n = 1)
+            {
+                Shard &s = _shards[shardIndex()];
+                s.value.fetch_add(n, std::memory_order_relaxed);
+            }
+            uint64_t sum() const;
+
+        private:
+            enum { SHARDS = 16 };
+            //padded to a line instead of alignas, so a Looper holding counters is not over-aligned
+            struct Shard {
+                std::atomic<uint64_t> value{ 0 };
+                char pad[64 - sizeof(std::atomic<uint64_t>)];
+            };
+            static size_t shardIndex();
+            Shard _shards[SHARDS];
+        };
+
+        struct HistogramSnapshot {
+            uint64_t count = 0;
+            uint64_t max = 0;
+            double mean = 0.0;
+            std::vector<uint64_t> buckets;
+
+            //value below which p (0..1) of the samples fall, in the unit recorded
+            uint64_t percentile(double p) const;
+        };
+
+        // log-linear histogram in the spirit of HdrHistogram: 16 sub-buckets per power
+        // of two, so a reported value is within ~6% of the recorded one. Written by a
+        // single thread without read-modify-write, read from any thread.
+        class LatencyHistogram {
+        public:
+            enum {
+                SUB_BITS = 4,
+                SUB = 1 << SUB_BITS,
+                BUCKETS = (64 - SUB_BITS + 1) * SUB,
+            };
+
+            LatencyHistogram();
+
+            void record(uint64_t value)
+            {
+                std::atomic<uint64_t> &b = _buckets[bucketOf(value)];
+                b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                _sum.store(_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+                if (value > _max.load(std::memory_order_relaxed)) _max.store(value, std::memory_order_relaxed);
+            }
+
+            HistogramSnapshot snapshot() const;
+
+            static size_t bucketOf(uint64_t value);
+            static uint64_t lowerBound(size_t bucket);
+
+        private:
+            std::atomic<uint64_t> _buckets[BUCKETS];
+            std::atomic<uint64_t> _sum{ 0 };
+            std::atomic<uint64_t> _max{ 0 };
+        };
+
+        // what Looper::snapshot() returns, times are nanoseconds
+        struct MetricsSnapshot {
+            uint64_t emitted = 0;
+            uint64_t dispatched = 0;
+            uint64_t external = 0;
+            uint64_t handled = 0;
+            uint64_t queueDepth = 0;            //posted but not yet handled
+
+            HistogramSnapshot latency;          //enqueue to execute, needs timing enabled
+            HistogramSnapshot tickDrift;        //Loop::update behind its schedule point
+            std::vector<std::pair<std::string, HistogramSnapshot> > handlerTime;    //per event name, needs timing enabled
+
+            int64_t uptimeNs = 0;
+            int64_t idleNs = 0;                 //blocked in uv poll
+            double utilization() const { return uptimeNs > 0 ? 1.0 - (double)idleNs / uptimeNs : 0.0; }
+        };
+
+        int64_t metricsNowNs();
+
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <memory>
+#include <cassert>
+
+#include "Looper.h"
+#include "LooperGroup.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // owns one Looper per ThreadCategory so callers route work by category
+        // instead of passing Looper pointers around. ANY_THREAD work goes to a
+        // LooperGroup. configure() every category in use, then start() once.
+        template<typename LoopEvent>
+        class LoopMgr {
+        public:
+            typedef typename Looper<LoopEvent>::Ptr LooperPtr;
+            typedef typename Looper<LoopEvent>::DispatchF DispatchF;
+            typedef typename Looper<LoopEvent>::EventCF EventCF;
+            typedef typename LooperGroup<LoopEvent>::Options GroupOptions;
+
+            struct CategoryConfig {
+                Loop *task = nullptr;
+                int64_t updateMs = 1000;
+                ThreadConfig thread;
+                size_t drainItems = 0;                  //see Looper::setDrainBudget()
+                std::chrono::microseconds drainTime{ 0 };
+            };
+
+            static LoopMgr &getInstance();
+
+            void configure(ThreadCategory cate, const CategoryConfig &cfg);
+            void configureAnyThread(const GroupOptions &opts);
+            void start();
+            void stop();
+
+            //retune a running category, e.g. from its measured tick drift
+            void setDrainBudget(ThreadCategory cate, size_t maxItems, std::chrono::microseconds maxTime) { get(cate)->setDrainBudget(maxItems, maxTime); }
+
+            LooperPtr get(ThreadCategory cate);
+            LooperGroup<LoopEvent> *getAnyThreadGroup() { return _anyThread.get(); }
+            bool isCurrentThread(ThreadCategory cate);
+
+            //the priority only applies to category Loopers, the ANY_THREAD group has one lane
+            void dispatch(ThreadCategory cate, DispatchF fn, MailPriority prio = MailPriority::NORMAL);
+            void wait(ThreadCategory cate, DispatchF fn, MailPriority prio = MailPriority::NORMAL);
+            template<typename F>
+            Future<typename FutureResult<void, F>::type> submit(ThreadCategory cate, F fn, MailPriority prio = MailPriority::NORMAL);
+
+            //category Loopers only, the ANY_THREAD group has no timers
+            TimerHandle dispatchAfter(ThreadCategory cate, std::chrono::nanoseconds delay, DispatchF fn) { return get(cate)->dispatchAfter(delay, std::move(fn)); }
+            TimerHandle dispatchEvery(ThreadCategory cate, std::chrono::nanoseconds period, DispatchF fn) { return get(cate)->dispatchEvery(period, std::move(fn)); }
+
+            bool emit(ThreadCategory cate, EventId id, LoopEvent &ev, MailPriority prio = MailPriority::NORMAL) { return get(cate)->emit(id, ev, prio); }
+            bool emit(ThreadCategory cate, EventId id, LoopEvent &&ev, MailPriority prio = MailPriority::NORMAL) { return get(cate)->emit(id, std::move(ev), prio); }
+            void on(ThreadCategory cate, EventId id, EventCF cb) { get(cate)->on(id, cb); }
+            template<typename T>
+            bool emit(ThreadCategory cate, const Channel<T> &ch, typename Channel<T>::Type &&value, MailPriority prio = MailPriority::NORMAL) { return get(cate)->emit(ch, std::move(value), prio); }
+            template<typename T>
+            void on(ThreadCategory cate, const Channel<T> &ch, typename Channel<T>::Handler cb) { get(cate)->on(ch, std::move(cb)); }
+
+        private:
+            enum { CATEGORY_COUNT = 4 };
+
+            struct Slot {
+                bool configured = false;
+                CategoryConfig cfg;
+                LooperPtr looper;
+            };
+
+            static int slotOf(ThreadCategory cate);
+
+            Slot _slots[CATEGORY_COUNT];
+            bool _anyConfigured = false;
+            GroupOptions _anyOpts;
+            std::unique_ptr<LooperGroup<LoopEvent> > _anyThread;
+            bool _started = false;
+        };
+
+
+        template<typename LoopEvent>
+        LoopMgr<LoopEvent> &LoopMgr<LoopEvent>::getInstance()
+        {
+            static LoopMgr<LoopEvent> instance;
+            return instance;
+        }
+
+        template<typename LoopEvent>
+        int LoopMgr<LoopEvent>::slotOf(ThreadCategory cate)
+        {
+            switch (cate)
+            {
+            case ThreadCategory::MAIN_THREAD: return 0;
+            case ThreadCategory::PHYSICS_THREAD: return 1;
+            case ThreadCategory::RENDER_THREAD: return 2;
+            case ThreadCategory::NET_THREAD: return 3;
+            default: return -1;
+            }
+        }
+
+        template<typename LoopEvent>
+        void LoopMgr<LoopEvent>::configure(ThreadCategory cate, const CategoryConfig &cfg)
+        {
+            assert(!_started);
+            int idx = slotOf(cate);
+            assert(idx >= 0); //use configureAnyThread() for ANY_THREAD
+            _slots[idx].configured = true;
+            _slots[idx].cfg = cfg;
+        }
+
+        template<typename LoopEvent>
+        void LoopMgr<LoopEvent>::configureAnyThread(const GroupOptions &opts)
+        {
+            assert(!_started);
+            _anyConfigured = true;
+            _anyOpts = opts;
+        }
+
+        template<typename LoopEvent>
+        void LoopMgr<LoopEvent>::start()
+        {
+            assert(!_started);
+            _started = true;
+            for (int i = 0; i < CATEGORY_COUNT; i++)
+            {
+                Slot &slot = _slots[i];
+                if (!slot.configured) continue;
+                ThreadCategory cate = (ThreadCategory)(1 << i);
+                slot.looper = std::make_shared<Looper<LoopEvent> >(cate, slot.cfg.task, slot.cfg.updateMs);
+                slot.looper->setThreadConfig(slot.cfg.thread);
+                slot.looper->setDrainBudget(slot.cfg.drainItems, slot.cfg.drainTime);
+                slot.looper->run();
+            }
+            if (_anyConfigured)
+            {
+                _anyThread.reset(new LooperGroup<LoopEvent>(_anyOpts));
+                _anyThread->start();
+            }
+        }
+
+        template<typename LoopEvent>
+        void LoopMgr<LoopEvent>::stop()
+        {
+            if (!_started) return;
+            _started = false;
+            if (_anyThread)
+            {
+                _anyThread->stop();
+                _anyThread.reset();
+            }
+            for (int i = 0; i < CATEGORY_COUNT; i++)
+            {
+                Slot &slot = _slots[i];
+                if (!slot.looper) continue;
+                slot.looper->syncStop();
+                slot.looper->join();
+                slot.looper.reset();
+            }
+        }
+
+        template<typename LoopEvent>
+        typename LoopMgr<LoopEvent>::LooperPtr LoopMgr<LoopEvent>::get(ThreadCategory cate)
+        {
+            int idx = slotOf(cate);
+            assert(idx >= 0 && _slots[idx].looper);
+            return _slots[idx].looper;
+        }
+
+        template<typename LoopEvent>
+        bool LoopMgr<LoopEvent>::isCurrentThread(ThreadCategory cate)
+        {
+            int idx = slotOf(cate);
+            return idx >= 0 && _slots[idx].looper && _slots[idx].looper->isCurrentThread();
+        }
+
+        template<typename LoopEvent>
+        void LoopMgr<LoopEvent>::dispatch(ThreadCategory cate, DispatchF fn, MailPriority prio)
+        {
+            if (cate == ThreadCategory::ANY_THREAD)
+            {
+                assert(_anyThread);
+                _anyThread->dispatch(std::move(fn));
+                return;
+            }
+            get(cate)->dispatch(std::move(fn), prio);
+        }
+
+        template<typename LoopEvent>
+        void LoopMgr<LoopEvent>::wait(ThreadCategory cate, DispatchF fn, MailPriority prio)
+        {
+            if (cate == ThreadCategory::ANY_THREAD)
+            {
+                submit(cate, std::move(fn)).wait();
+                return;
+            }
+            get(cate)->wait(std::move(fn), prio);
+        }
+
+        template<typename LoopEvent>
+        template<typename F>
+        Future<typename FutureResult<void, F>::type> LoopMgr<LoopEvent>::submit(ThreadCategory cate, F fn, MailPriority prio)
+        {
+            typedef typename FutureResult<void, F>::type R;
+            std::shared_ptr<FutureState<R> > state = std::make_shared<FutureState<R> >();
+            dispatch(cate, FutureTask<R, F>(state, std::move(fn)), prio);
+            return Future<R>(state);
+        }
+
+    }
+}
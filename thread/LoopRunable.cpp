@@ -1,64 +1,375 @@
 #include "LoopRunable.h"
 
 #include <cassert>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#include "AtomicWait.h"
+
 namespace cocos2d
 {
     namespace loop
     {
-        LoopRunable::LoopRunable(uv_loop_t *loop, Loop *tsk, milliseconds interval) :
-            _uvLoop(loop), _task(tsk), _intervalMS(duration_cast<milliseconds>(interval).count())
+        //the fallback precise timer wakes this much plus twice the measured timer slack
+        //before the deadline and spins the rest, see setMaxSpin()
+        static const int64_t PRECISE_SPIN_MARGIN_NS = 100000LL;
+
+        LoopRunable::LoopRunable(uv_loop_t *loop, Loop *tsk, nanoseconds interval, TickMode mode) :
+            _uvLoop(loop), _mode(mode)
         {
             uv_timer_init(loop, &_uvTimer);
             _uvTimer.data = this;
+            if (tsk)
+            {
+                LoopSchedule schedule;
+                schedule.task = tsk;
+                schedule.intervalNs = interval.count();
+                attach(schedule);
+                _primary = _entries.back().get();
+            }
+        }
+
+        void LoopRunable::setMaxSpin(nanoseconds maxSpin)
+        {
+            _maxSpinNs = maxSpin.count() > 0 ? maxSpin.count() : 0;
+            _slackNs = _maxSpinNs / 2;
+        }
+
+        void LoopRunable::setOverrunPolicy(OverrunPolicy policy, int maxSteps)
+        {
+            if (!_primary)
+                return;
+            _primary->cfg.policy = policy;
+            _primary->cfg.maxSteps = maxSteps > 0 ? maxSteps : 1;
+        }
+
+        void LoopRunable::attach(const LoopSchedule &schedule)
+        {
+            assert(schedule.task);
+            Entry *e = new Entry();
+            e->cfg = schedule;
+            if (e->cfg.intervalNs <= 0)
+                e->cfg.intervalNs = 1;
+            if (e->cfg.maxSteps <= 0)
+                e->cfg.maxSteps = 1;
+            _entries.push_back(std::unique_ptr<Entry>(e));
+            if (!_started)
+                return;
+            start(*e, steady_clock::now());
+            //an update attaching a loop leaves the arming to the end of its tick
+            if (!_running && e->pos == _queue.begin())
+                arm();
+        }
+
+        bool LoopRunable::detach(Loop *task)
+        {
+            for (auto &ptr : _entries)
+            {
+                Entry &e = *ptr;
+                if (e.cfg.task != task || e.detached)
+                    continue;
+                if (&e == _running || (_running && e.started && !e.queued))
+                {
+                    e.detached = true; //ran or running in this tick, runDue() removes it at the end
+                    return true;
+                }
+                remove(e);
+                return true;
+            }
+            return false;
+        }
+
+        void LoopRunable::start(Entry &e, time_point<steady_clock> now)
+        {
+            e.started = true;
+            e.cfg.task->before();
+            e.anchor = now + nanoseconds(e.cfg.phaseNs);
+            e.lastUpdate = e.anchor;
+            e.accumNs = 0;
+            e.updateTimes = 1;
+            enqueue(e);
+        }
+
+        void LoopRunable::enqueue(Entry &e)
+        {
+            e.pos = _queue.insert(std::make_pair(e.expectTime(), &e));
+            e.queued = true;
+        }
+
+        void LoopRunable::stop(Entry &e)
+        {
+            if (e.queued)
+            {
+                _queue.erase(e.pos);
+                e.queued = false;
+            }
+            if (e.started)
+            {
+                e.started = false;
+                e.cfg.task->after();
+            }
+        }
+
+        void LoopRunable::remove(Entry &e)
+        {
+            stop(e);
+            if (_primary == &e)
+                _primary = nullptr;
+            for (auto it = _entries.begin(); it != _entries.end(); ++it)
+            {
+                if (it->get() == &e)
+                {
+                    _entries.erase(it);
+                    return;
+                }
+            }
         }
 
         void LoopRunable::beforeRun()
         {
-            if (_task)
-                _task->before();
-            _startTime = high_resolution_clock::now();
-            _updateTimes = 1;
+            _started = true;
+            auto now = steady_clock::now();
+            //before() may attach more loops, which start themselves
+            for (size_t i = 0; i < _entries.size(); i++)
+            {
+                if (!_entries[i]->started)
+                    start(*_entries[i], now);
+            }
+            if (_mode == TickMode::PRECISE && startTimerFd())
+                return;
             scheduleTaskUpdate();
         }
 
-        void LoopRunable::run()
+        int LoopRunable::run(uv_run_mode mode)
         {
             //schedule update for task
-            uv_run(_uvLoop, UV_RUN_DEFAULT);
+            return uv_run(_uvLoop, mode);
         }
 
         void LoopRunable::afterRun()
         {
-            if (_task)
-                _task->after();
+            for (auto &e : _entries)
+                stop(*e);
+            _started = false;
+#ifdef __linux__
+            if (_timerFd >= 0)
+            {
+                uv_poll_stop(&_uvPoll);
+                close(_timerFd);
+                _timerFd = -1;
+            }
+#endif
             uv_loop_close(_uvLoop);
         }
 
         static void timer_handle(uv_timer_t *timer)
         {
             LoopRunable *self = (LoopRunable*)timer->data;
-            self->onTimer();
-            self->scheduleTaskUpdate();
+            self->scheduleTaskUpdate(true);
         }
 
-        void LoopRunable::onTimer()
+        static void precise_timer_handle(uv_timer_t *timer)
         {
-            _updateTimes += 1;
-            if (_task)
-                _task->update((int)_intervalMS);
+            LoopRunable *self = (LoopRunable*)timer->data;
+            self->onPreciseTimer();
         }
 
-        void LoopRunable::scheduleTaskUpdate()
+        //every loop whose schedule point has passed gets its tick, each at most once
+        void LoopRunable::runDue(time_point<steady_clock> now, bool fired)
         {
-            auto now = high_resolution_clock::now();
-            while (expectTime() <= now) {
-                onTimer();
+            //the millisecond uv timer may fire slightly before the point it was armed for
+            auto cutoff = fired && _armedFor > now ? _armedFor : now;
+            while (!_queue.empty() && _queue.begin()->first <= cutoff)
+            {
+                Entry *e = _queue.begin()->second;
+                _queue.erase(_queue.begin());
+                e->queued = false;
+                _running = e;
+                onTimer(*e, now, fired);
+                _running = nullptr;
+                _ran.push_back(e);
             }
-            //auto diff = expectTime() - high_resolution_clock::now();
-            auto diff = expectTime() - now;
-            auto delay = duration_cast<milliseconds>(diff).count();
-            assert(delay >= 0);
-            uv_timer_start(&_uvTimer, timer_handle, delay, 0);
+            for (Entry *e : _ran)
+            {
+                if (e->detached)
+                    remove(*e);
+                else
+                    enqueue(*e);
+            }
+            _ran.clear();
+        }
+
+        //runs the updates for every schedule point up to now, then moves the schedule past it
+        void LoopRunable::onTimer(Entry &e, time_point<steady_clock> now, bool fired)
+        {
+            int64_t passedNs = duration_cast<nanoseconds>(now - e.anchor).count();
+            int64_t last = passedNs >= 0 ? passedNs / e.cfg.intervalNs : 0;
+            if (fired && last < e.updateTimes)
+                last = e.updateTimes;
+            int64_t due = last - e.updateTimes + 1;
+            if (due <= 0)
+                return;
+            e.updateTimes = last + 1;
+            if (_drift)
+            {
+                int64_t lateNs = passedNs - last * e.cfg.intervalNs;
+                _drift->record(lateNs > 0 ? (uint64_t)lateNs : 0);
+            }
+            runUpdates(e, due, now);
+        }
+
+        void LoopRunable::runUpdates(Entry &e, int64_t due, time_point<steady_clock> now)
+        {
+            int64_t elapsedNs = duration_cast<nanoseconds>(now - e.lastUpdate).count();
+            e.lastUpdate = now;
+            Loop *task = e.cfg.task;
+            int64_t intervalNs = e.cfg.intervalNs;
+            int maxSteps = e.cfg.maxSteps;
+            switch (e.cfg.policy)
+            {
+            case OverrunPolicy::CATCH_UP:
+            {
+                //the first step takes what the nominal steps do not cover
+                int64_t steps = due < maxSteps ? due : maxSteps;
+                int64_t firstNs = elapsedNs - (due - 1) * intervalNs;
+                task->update((firstNs > 0 ? firstNs : 0) / 1000);
+                for (int64_t i = 1; i < steps && !e.detached; i++)
+                    task->update(intervalNs / 1000);
+                break;
+            }
+            case OverrunPolicy::DROP:
+                //the missed time is dropped with the ticks, a late update still reports one interval
+                task->update((due > 1 ? intervalNs : elapsedNs) / 1000);
+                break;
+            case OverrunPolicy::COALESCE:
+                task->update(elapsedNs / 1000);
+                break;
+            case OverrunPolicy::FIXED_STEP:
+            {
+                e.accumNs += elapsedNs;
+                int steps = 0;
+                while (e.accumNs >= intervalNs && steps < maxSteps && !e.detached)
+                {
+                    task->update(intervalNs / 1000);
+                    e.accumNs -= intervalNs;
+                    steps += 1;
+                }
+                if (e.detached)
+                    break;
+                if (e.accumNs >= intervalNs)
+                    e.accumNs %= intervalNs;
+                task->interpolate((double)e.accumNs / intervalNs);
+                break;
+            }
+            }
+        }
+
+        void LoopRunable::scheduleTaskUpdate(bool fired)
+        {
+            runDue(steady_clock::now(), fired && _mode == TickMode::UV_TIMER);
+            arm();
+        }
+
+        //aims the one timer at the earliest schedule point of all loops
+        void LoopRunable::arm()
+        {
+            if (_queue.empty())
+            {
+                uv_timer_stop(&_uvTimer);
+                if (_timerFd >= 0)
+                    armTimerFd(time_point<steady_clock>());
+                return;
+            }
+            _armedFor = _queue.begin()->first;
+            if (_timerFd >= 0)
+            {
+                armTimerFd(_armedFor);
+                return;
+            }
+            auto now = steady_clock::now();
+            if (_mode == TickMode::PRECISE)
+            {
+                //fallback precise mode: sleep in uv until shortly before the deadline, then spin
+                int64_t spinNs = _slackNs * 2 + PRECISE_SPIN_MARGIN_NS;
+                if (spinNs > _maxSpinNs) spinNs = _maxSpinNs;
+                int64_t leftNs = duration_cast<nanoseconds>(_armedFor - now).count();
+                int64_t delay = (leftNs - spinNs) / 1000000LL;
+                if (delay < 0) delay = 0;
+                //uv_now is cached at the start of the loop iteration, which would make the timer late
+                uv_update_time(_uvLoop);
+                _wakeAt = now + milliseconds(delay);
+                uv_timer_start(&_uvTimer, precise_timer_handle, delay, 0);
+                return;
+            }
+            auto delay = duration_cast<milliseconds>(_armedFor - now).count();
+            uv_timer_start(&_uvTimer, timer_handle, delay > 0 ? delay : 0, 0);
+        }
+
+        void LoopRunable::onPreciseTimer()
+        {
+            //follow how late the uv timer fires, a missed deadline widens the window at once
+            auto now = steady_clock::now();
+            int64_t lateNs = duration_cast<nanoseconds>(now - _wakeAt).count();
+            if (now > _armedFor && lateNs < _maxSpinNs) lateNs = _maxSpinNs;
+            _slackNs += ((lateNs > 0 ? lateNs : 0) - _slackNs) / 8;
+            while (steady_clock::now() < _armedFor) {
+                AtomicWait::pause();
+            }
+            scheduleTaskUpdate();
+        }
+
+#ifdef __linux__
+        static void timerfd_handle(uv_poll_t *handle, int status, int events)
+        {
+            LoopRunable *self = (LoopRunable*)handle->data;
+            self->onTimerFd();
+        }
+#endif
+
+        bool LoopRunable::startTimerFd()
+        {
+#ifdef __linux__
+            //steady_clock is CLOCK_MONOTONIC, so deadlines are absolute times on the same clock
+            _timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (_timerFd < 0)
+                return false;
+            uv_poll_init(_uvLoop, &_uvPoll, _timerFd);
+            _uvPoll.data = this;
+            uv_poll_start(&_uvPoll, UV_READABLE, timerfd_handle);
+            arm();
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        //a default deadline disarms it
+        void LoopRunable::armTimerFd(time_point<steady_clock> deadline)
+        {
+#ifdef __linux__
+            itimerspec spec = {};
+            if (deadline != time_point<steady_clock>())
+            {
+                int64_t ns = duration_cast<nanoseconds>(deadline.time_since_epoch()).count();
+                spec.it_value.tv_sec = (time_t)(ns / 1000000000LL);
+                spec.it_value.tv_nsec = (long)(ns % 1000000000LL);
+            }
+            timerfd_settime(_timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+#endif
+        }
+
+        void LoopRunable::onTimerFd()
+        {
+#ifdef __linux__
+            uint64_t expirations = 0;
+            if (read(_timerFd, &expirations, sizeof(expirations)) < 0)
+                return;
+            scheduleTaskUpdate();
+#endif
         }
     }
 }
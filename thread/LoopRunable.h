@@ -2,9 +2,12 @@
 
 #include <memory>
 #include <chrono>
+#include <map>
+#include <vector>
 #include "uv.h"
 
 #include "Loop.h"
+#include "LoopMetrics.h"
 
 namespace cocos2d
 {
@@ -13,26 +16,97 @@ namespace cocos2d
 
         using namespace std::chrono;
 
+        enum class TickMode {
+            UV_TIMER,   //uv_timer_t, millisecond resolution against the cached uv_now
+            PRECISE,    //timerfd with absolute deadlines on linux, sleep then spin elsewhere
+        };
+
+        //what a late tick does with the schedule points it missed.
+        //only COALESCE always reports the measured time. DROP deliberately reports one nominal
+        //interval after a hitch, so simulated time falls behind wall time by what was dropped;
+        //that is the difference to COALESCE
+        enum class OverrunPolicy {
+            CATCH_UP,   //replay missed ticks back to back, at most maxSteps of them
+            DROP,       //skip missed ticks, one update of a nominal interval instead of the measured dt
+            COALESCE,   //one update covering the whole elapsed time
+            FIXED_STEP, //accumulate elapsed time, fixed interval updates then Loop::interpolate()
+        };
+
+        //one Loop hosted by a LoopRunable, with its own rate
+        struct LoopSchedule {
+            Loop *task = nullptr;
+            int64_t intervalNs = 1000000000LL;
+            int64_t phaseNs = 0;        //delay of the schedule points against the other loops
+            OverrunPolicy policy = OverrunPolicy::CATCH_UP;
+            int maxSteps = 5;           //bounds the updates of one late tick, the rest of the backlog is dropped
+        };
+
+        // drives any number of Loops from one uv timer (or timerfd in PRECISE mode),
+        // armed for the earliest schedule point of all of them. Looper thread only
         class LoopRunable {
         public:
-            LoopRunable(uv_loop_t *loop, Loop *tsk, milliseconds interval);
+            LoopRunable(uv_loop_t *loop, Loop *tsk, nanoseconds interval, TickMode mode = TickMode::UV_TIMER);
+            //policy of the Loop given to the constructor
+            void setOverrunPolicy(OverrunPolicy policy, int maxSteps);
+            //fallback PRECISE mode (no timerfd): the spin before a deadline follows the measured
+            //slack of the uv timer and never exceeds maxSpin
+            void setMaxSpin(nanoseconds maxSpin);
+            //records how late each tick runs behind its schedule point, in ns
+            void setDriftHistogram(LatencyHistogram *hist) { _drift = hist; }
+            //can be called before or while running, Loop::before() runs when the loop starts being driven
+            void attach(const LoopSchedule &schedule);
+            //Loop::after() runs if it had started, false if the loop is not attached
+            bool detach(Loop *task);
+            size_t loopCount() const { return _entries.size(); }
             void beforeRun();
-            void run();
+            int run(uv_run_mode mode = UV_RUN_DEFAULT);
             void afterRun();
-            void scheduleTaskUpdate();
-            void onTimer();
-            time_point<high_resolution_clock> expectTime()
-            {
-                return _startTime + milliseconds(_intervalMS * _updateTimes);
-            }
+            void scheduleTaskUpdate(bool fired = false);
+            void onPreciseTimer();
+            void onTimerFd();
         private:
-            Loop * _task = nullptr;
+            struct Entry;
+            typedef std::multimap<time_point<steady_clock>, Entry*> Queue;
+            struct Entry {
+                LoopSchedule cfg;
+                time_point<steady_clock> anchor;    //start time plus the phase
+                int64_t updateTimes = 0;
+                time_point<steady_clock> lastUpdate;
+                int64_t accumNs = 0;
+                bool started = false;
+                bool queued = false;
+                bool detached = false;              //detached during the tick it ran in
+                Queue::iterator pos;
+                time_point<steady_clock> expectTime() const { return anchor + nanoseconds(cfg.intervalNs * updateTimes); }
+            };
+
+            void start(Entry &e, time_point<steady_clock> now);
+            void enqueue(Entry &e);
+            void stop(Entry &e);
+            void remove(Entry &e);
+            void runDue(time_point<steady_clock> now, bool fired);
+            void onTimer(Entry &e, time_point<steady_clock> now, bool fired);
+            void runUpdates(Entry &e, int64_t due, time_point<steady_clock> now);
+            void arm();
+            bool startTimerFd();
+            void armTimerFd(time_point<steady_clock> deadline);
+
             uv_loop_t *_uvLoop = nullptr;
             uv_timer_t _uvTimer;
-            int64_t _intervalMS = 3000LL;
-            time_point<high_resolution_clock> _startTime;
-            int64_t _updateTimes = 0LL;
+            TickMode _mode = TickMode::UV_TIMER;
+            std::vector<std::unique_ptr<Entry> > _entries;
+            Queue _queue;                           //every started entry by its next schedule point
+            Entry *_primary = nullptr;
+            Entry *_running = nullptr;
+            std::vector<Entry*> _ran;               //entries of the current runDue(), requeued after it
+            bool _started = false;
+            time_point<steady_clock> _armedFor;
+            time_point<steady_clock> _wakeAt;       //fallback precise mode: when the uv timer should fire
+            int64_t _maxSpinNs = 2000000LL;
+            int64_t _slackNs = 1000000LL;           //running average of how late the uv timer fires
+            LatencyHistogram *_drift = nullptr;
+            int _timerFd = -1;
+            uv_poll_t _uvPoll;
         };
     }
 }
-
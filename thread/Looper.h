@@ -19,7 +19,17 @@
 #include "ThreadLoop.h"
 #include "Loop.h"
 #include "Finalizer.h"
-#include "SeqItem.h"
+#include "ThreadConfig.h"
+#include "MailItem.h"
+#include "EventId.h"
+#include "UniqueFunction.h"
+#include "Future.h"
+#include "Coroutine.h"
+#include "MpscQueue.h"
+#include "MpmcRing.h"
+#include "LoopMetrics.h"
+#include "TimerWheel.h"
+#include "Channel.h"
 
 #include <memory>
 
@@ -38,8 +48,38 @@ namespace cocos2d
             NET_THREAD = 1 << 3,
         };
 
+        enum class PollMode {
+            SLEEP,      //block in uv poll until woken
+            BUSY_POLL,  //spin on the mailbox between non-blocking uv runs, park when idle
+        };
+
+        //mailbox lanes, each FIFO. Urgent mail is handled before normal mail, background
+        //mail when the others are empty and now and then anyway so it never starves
+        enum class MailPriority {
+            URGENT,
+            NORMAL,
+            BACKGROUND,
+        };
+
+        //what emit() does when the mailbox is at capacity, see Looper::setCapacity()
+        enum class OverflowPolicy {
+            BLOCK,          //wait for room up to the block timeout, then drop the event
+            FAIL,           //return false right away
+            DROP_NEWEST,    //drop the event that does not fit, return false
+            DROP_OLDEST,    //per event only: the event gets its own ring that evicts its oldest entry
+        };
+
         template<typename LoopEvent>
         static void async_handle(uv_async_t *data);
+        template<typename LoopEvent>
+        static void idle_handle(uv_idle_t *data);
+        template<typename LoopEvent>
+        static void prepare_handle(uv_prepare_t *data);
+        //poll returned, timers and i/o callbacks are about to run
+        template<typename LoopEvent>
+        static void check_handle(uv_check_t *data);
+        template<typename LoopEvent>
+        static void wheel_handle(uv_timer_t *data);
 
         template<typename LoopEvent>
         class Looper : public std::enable_shared_from_this<Looper<LoopEvent> > {
@@ -48,9 +88,27 @@ namespace cocos2d
 
         public:
             typedef std::function<void(LoopEvent&)> EventCF;
-            typedef std::function<void()> DispatchF;
+            typedef UniqueFunction<void()> DispatchF;
             typedef std::shared_ptr<Looper<LoopEvent> > Ptr;
 
+            struct DrainStats {
+                uint64_t drains = 0;    //batches taken from the mailbox
+                uint64_t items = 0;     //items handled from those batches
+                uint64_t maxBatch = 0;
+                uint64_t wakeups = 0;   //uv_async_send calls made by producers
+                uint64_t carryOvers = 0;  //drains cut by the budget, resumed on the next loop iteration
+                double itemsPerDrain() const { return drains ? (double)items / drains : 0.0; }
+                double wakeupsPer1k() const { return items ? wakeups * 1000.0 / items : 0.0; }
+            };
+
+            struct OverflowStats {
+                uint64_t rejected = 0;      //FAIL, tryEmit() and tryDispatch() without room
+                uint64_t droppedNewest = 0;
+                uint64_t droppedOldest = 0;
+                uint64_t blocked = 0;       //emits that had to wait for room
+                uint64_t blockTimeouts = 0; //of those, dropped after the timeout
+            };
+
             static Looper *getCurrentThread();
             static void setLocalData(const std::string &name, void *data);
             static void* getLocalData(const std::string &name);
@@ -63,54 +121,276 @@ namespace cocos2d
 
             void init();
 
+            //pinning/priority of the looper thread, call before run()
+            void setThreadConfig(const ThreadConfig &cfg) { assert(!_threadId); _threadConfig = cfg; }
+            ThreadCategory getCategory() const { return _category; }
+            //trade cpu for dispatch latency, maxSpin bounds the adaptive spin before parking
+            void setPollMode(PollMode mode, microseconds maxSpin = microseconds(200));
+            //update interval of the Loop task, fractional values such as 1000.0 / 60 are kept exact
+            void setUpdateInterval(double intervalMs) { assert(!_threadId); _intervalNs = (int64_t)(intervalMs * 1e6); }
+            //PRECISE uses a timerfd on linux. Elsewhere it sleeps in uv and spins onto every
+            //deadline: about twice the measured timer slack per tick, never more than maxSpin,
+            //so at high tick rates it still costs up to maxSpin / interval of a core
+            void setTickMode(TickMode mode, microseconds maxSpin = microseconds(2000)) { assert(!_threadId); _tickMode = mode; _tickSpinNs = duration_cast<nanoseconds>(maxSpin).count(); }
+            //how late ticks are handled, maxSteps bounds the updates of a single tick
+            void setOverrunPolicy(OverrunPolicy policy, int maxSteps = 5) { assert(!_threadId); _overrunPolicy = policy; _maxSteps = maxSteps; }
+            //host another Loop on this thread at its own rate, before or while running.
+            //phaseMs shifts its schedule points, e.g. to keep loops of the same rate off one tick
+            void attachLoop(Loop *loop, double intervalMs, double phaseMs = 0, OverrunPolicy policy = OverrunPolicy::CATCH_UP, int maxSteps = 5);
+            //update() is not called again once this returns, blocks when called from another thread
+            void detachLoop(Loop *loop);
+            //bound the mailbox to maxQueued items (0 is unbounded), call before run().
+            //dispatched closures are always accepted so wait()/submit() keep working, they
+            //only count towards the fill level; use tryDispatch() to shed them
+            void setCapacity(size_t maxQueued, OverflowPolicy policy = OverflowPolicy::BLOCK, milliseconds blockTimeout = milliseconds(100));
+            //overrides the capacity policy for one event, call before run()
+            void setOverflowPolicy(EventId id, OverflowPolicy policy, size_t ringSize = 256);
+            //mail handled per wakeup before timers and uv i/o get a turn, 0 is unlimited.
+            //can be changed at any time. Nested drains (wait() on the looper thread) ignore it
+            void setDrainBudget(size_t maxItems, microseconds maxTime = microseconds(0));
+            size_t getDrainBudgetItems() const { return _budgetItems.load(std::memory_order_relaxed); }
+            microseconds getDrainBudgetTime() const { return microseconds(_budgetNs.load(std::memory_order_relaxed) / 1000); }
+
             void run();
             void asyncStop();
             bool syncStop();
             void join();
             void detach();
 
-            void emit(const std::string &name, LoopEvent &arg);
-            void on(const std::string &name, EventCF callback);
-            void off(const std::string &name);
-
-            void dispatch(DispatchF fn);
-            void wait(DispatchF fn);
-            void wait(DispatchF fn, int timeoutMS);
+            //false if the event was not queued because of the overflow policy
+            bool emit(EventId id, LoopEvent &arg, MailPriority prio = MailPriority::NORMAL) { return postEvent(id, prio, true, arg); }
+            bool emit(EventId id, LoopEvent &&arg, MailPriority prio = MailPriority::NORMAL) { return postEvent(id, prio, true, std::move(arg)); }
+            //never blocks, false when there is no room
+            bool tryEmit(EventId id, LoopEvent &arg, MailPriority prio = MailPriority::NORMAL) { return postEvent(id, prio, false, arg); }
+            bool tryEmit(EventId id, LoopEvent &&arg, MailPriority prio = MailPriority::NORMAL) { return postEvent(id, prio, false, std::move(arg)); }
+            //construct the event in place inside the mailbox item
+            template<typename ...Args>
+            bool emplace(EventId id, Args&&... args) { return postEvent(id, MailPriority::NORMAL, true, std::forward<Args>(args)...); }
+            void on(EventId id, EventCF callback);
+            void off(EventId id);
+
+            bool emit(const std::string &name, LoopEvent &arg, MailPriority prio = MailPriority::NORMAL) { return emit(EventId::of(name), arg, prio); }
+            bool emit(const std::string &name, LoopEvent &&arg, MailPriority prio = MailPriority::NORMAL) { return emit(EventId::of(name), std::move(arg), prio); }
+            void on(const std::string &name, EventCF callback) { on(EventId::of(name), callback); }
+            void off(const std::string &name) { off(EventId::of(name)); }
+
+            //typed channels, any number of payload types on one Looper. They share the
+            //capacity and its policy with the events, per event overflow policies do not apply
+            template<typename T>
+            void on(const Channel<T> &ch, typename Channel<T>::Handler callback);
+            template<typename T>
+            void off(const Channel<T> &ch);
+            template<typename T>
+            bool emit(const Channel<T> &ch, typename Channel<T>::Type &&value, MailPriority prio = MailPriority::NORMAL) { return postChannel(ch, prio, true, std::move(value)); }
+            template<typename T>
+            bool emit(const Channel<T> &ch, const typename Channel<T>::Type &value, MailPriority prio = MailPriority::NORMAL) { return postChannel(ch, prio, true, value); }
+            template<typename T>
+            bool tryEmit(const Channel<T> &ch, typename Channel<T>::Type &&value, MailPriority prio = MailPriority::NORMAL) { return postChannel(ch, prio, false, std::move(value)); }
+            template<typename T, typename ...Args>
+            bool emplace(const Channel<T> &ch, Args&&... args) { return postChannel(ch, MailPriority::NORMAL, true, std::forward<Args>(args)...); }
+
+            void dispatch(DispatchF fn, MailPriority prio = MailPriority::NORMAL);
+            //dispatch unless the mailbox is at capacity
+            bool tryDispatch(DispatchF fn, MailPriority prio = MailPriority::NORMAL);
+            void wait(DispatchF fn, MailPriority prio = MailPriority::NORMAL);
+            void wait(DispatchF fn, int timeoutMS, MailPriority prio = MailPriority::NORMAL);
+            //run fn on this looper, the result is delivered through the returned Future
+            template<typename F>
+            Future<typename FutureResult<void, F>::type> submit(F fn, MailPriority prio = MailPriority::NORMAL);
+            //queue an entry owned by the caller, see ExternalItem
+            void postExternal(ExternalItem *item, MailPriority prio = MailPriority::NORMAL);
+
+            //run fn on this looper once the time has come, millisecond resolution and never early.
+            //the timers live in a per looper timing wheel, arming and cancelling are O(1)
+            TimerHandle dispatchAfter(nanoseconds delay, DispatchF fn) { return addTimer(metricsNowNs() + delay.count(), 0, std::move(fn)); }
+            TimerHandle dispatchAt(steady_clock::time_point deadline, DispatchF fn) { return addTimer(duration_cast<nanoseconds>(deadline.time_since_epoch()).count(), 0, std::move(fn)); }
+            //every period from now until cancelled, late runs skip the periods they missed
+            TimerHandle dispatchEvery(nanoseconds period, DispatchF fn);
+
+#ifdef CC_LOOP_COROUTINES
+            //co_await looper->schedule() resumes the coroutine on this looper
+            ScheduleAwaiter<Looper> schedule() { return ScheduleAwaiter<Looper>(this); }
+#endif
 
             bool isCurrentThread() const;
 
             uv_loop_t *getUVLoop() { return _uvLoop; };
+            DrainStats getDrainStats() const;
+            //counters, histograms and utilization, callable from any thread
+            MetricsSnapshot snapshot();
+            //stamp every mail item and time every event handler, costs a clock read each
+            void setTimingMetrics(bool on) { _timing.store(on, std::memory_order_relaxed); }
+            size_t getCapacity() const { return _capacity; }
+            //items waiting in the mailbox, cheap enough to poll before every emit when bounded
+            size_t queued() const;
+            //queued() / capacity, 0 when unbounded
+            double fillLevel() const { return _capacity ? (double)_queued.load(std::memory_order_relaxed) / _capacity : 0.0; }
+            OverflowStats getOverflowStats() const;
 
         private:
             void notify();
-            void onNotify();
+            //budgeted for wakeups from uv handles, unlimited for inline calls
+            void onNotify(bool budgeted = false);
+            bool drainMailbox(bool budgeted);
+            void carryOver(bool left);
+            void pollLoop();
             void onStop();
             void onRun();
 
-            uint64_t genSeq() { return _eventFnSeq.fetch_add(1); }
-            void handleEvent(const std::string &name, LoopEvent &ev);
-            void handleFn(const DispatchF &fn);
+            void post(MailItem *item, MailPriority prio = MailPriority::NORMAL);
+            MailItem *popMail();
+            MailItem *popNormal();
+            static MailItem *popFrom(MpscQueue<MailItem> &box, MpscBatch<MailItem> &batch);
+            bool hasMail() const;
+            void handleCounted(MailItem *item);
+            void handleItem(MailItem *item);
+            void handleEvent(EventId id, LoopEvent &ev);
+            void handleFn(DispatchF &fn);
+            LatencyHistogram &handlerTime(EventId id);
+            TimerHandle addTimer(int64_t deadlineNs, int64_t periodNs, DispatchF fn);
+            void linkTimer(const std::shared_ptr<TimerNode> &node);
+            void armWheel();
+            void onWheelTimer();
+
+            //events with a DROP_OLDEST policy bypass the mailbox through their own ring
+            struct OldestLane : ExternalItem {
+                OldestLane(Looper *looper, EventId id, size_t size) : ExternalItem(&OldestLane::run), looper(looper), id(id), ring(size) {}
+                static void run(ExternalItem *item)
+                {
+                    OldestLane *lane = static_cast<OldestLane*>(item);
+                    lane->looper->drainLane(*lane);
+                }
+                Looper *looper;
+                EventId id;
+                MpmcRing<LoopEvent> ring;
+                std::atomic<bool> scheduled{ false };
+            };
+            struct EventOverflow {
+                bool set = false;
+                OverflowPolicy policy = OverflowPolicy::BLOCK;
+                std::unique_ptr<OldestLane> lane;
+            };
+
+            template<typename ...Args>
+            bool postEvent(EventId id, MailPriority prio, bool mayBlock, Args&&... args);
+            template<typename T, typename ...Args>
+            bool postChannel(const Channel<T> &ch, MailPriority prio, bool mayBlock, Args&&... args);
+            template<typename T>
+            static void deliverChannel(void *self, ChannelItem *item);
+            template<typename T>
+            ChannelTable<T> &channelTable();
+            template<typename T>
+            ChannelTable<T> *findChannelTable() const;
+            bool admit(OverflowPolicy policy, bool mayBlock);
+            void forceAdmit() { if (_capacity) _queued.fetch_add(1); }
+            bool waitForRoom(int64_t deadlineNs);
+            void release(uint64_t n);
+            template<typename E>
+            bool pushLane(OldestLane &lane, E &&event);
+            void drainLane(OldestLane &lane);
+            static void postExternalTo(void *self, ExternalItem *item) { static_cast<Looper*>(self)->postExternal(item); }
 
             ThreadCategory _category;
             Loop *_loop;
             std::shared_ptr<LoopRunable> _task;
-            ThreadSafeMapArray<std::string, EventCF> _callbackMap;
-            ThreadSafeQueue<SeqItem<LoopEvent>> _pendingEvents;
-            ThreadSafeQueue<SeqItem<DispatchF>> _pendingFns;
+            CowIndexArray<EventCF> _callbackMap;
+            //indexed by ChannelTypeIndex. A payload type is added once, so the snapshots only grow
+            //and the few old ones are kept until the Looper dies instead of tracking readers
+            std::atomic<const std::vector<ChannelTableBase*>*> _channelTables{ nullptr };
+            std::vector<std::unique_ptr<const std::vector<ChannelTableBase*> > > _channelSnapshots;
+            std::vector<std::unique_ptr<ChannelTableBase> > _channelOwned;
+            std::mutex _channelMtx;
+            MpscQueue<MailItem> _mailbox;
+            //batch being handled, kept in a member so reentrant onNotify() keeps the order
+            MpscBatch<MailItem> _draining;
+            uint64_t _drainingSize = 0;
+            MpscQueue<MailItem> _urgentBox;
+            MpscBatch<MailItem> _urgentDraining;
+            MpscQueue<MailItem> _backgroundBox;
+            MpscBatch<MailItem> _backgroundDraining;
+            uint32_t _sinceUrgentCheck = 0;
+            uint32_t _sinceBackground = 0;     //items handled since the last background one
+            uint64_t _unreleased = 0;          //handled items not yet given back to the capacity
+            std::atomic<size_t> _budgetItems{ 0 };
+            std::atomic<int64_t> _budgetNs{ 0 };
+            bool _carrying = false;             //idle handle active, mail left over from the last budget
+            std::atomic<uint64_t> _carryOvers{ 0 };
+            static const uint32_t BUDGET_CLOCK_EVERY = 16;  //items between clock reads of the time budget
+            static const uint32_t URGENT_CHECK = 16;        //normal items between looks at the urgent lane
+            static const uint32_t BACKGROUND_EVERY = 64;    //at most this many items before one background item
+            std::atomic<uint64_t> _drainCount{ 0 };
+            std::atomic<uint64_t> _drainedItems{ 0 };
+            std::atomic<uint64_t> _maxDrainBatch{ 0 };
+            //0 while the looper sleeps in poll; producers that find it awake skip uv_async_send
+            std::atomic<uint32_t> _awake{ 0 };
+            std::atomic<uint64_t> _wakeups{ 0 };
+            int _notifyDepth = 0;
+            static const uint64_t RELEASE_BATCH = 64;   //handled items before producers blocked on capacity are told
+
+            ShardedCounter _emitted;
+            ShardedCounter _dispatched;
+            ShardedCounter _external;
+            std::atomic<bool> _timing{ false };
+            LatencyHistogram _latency;
+            LatencyHistogram _tickDrift;
+            struct HandlerTime {
+                EventId id;
+                LatencyHistogram hist;
+            };
+            //indexed by EventId, grown by the looper thread under the mutex, snapshot() reads under it
+            std::vector<std::unique_ptr<HandlerTime> > _handlerTime;
+            std::mutex _handlerTimeMtx;
+            int64_t _startNs = 0;
+
+            std::vector<LoopSchedule> _pendingLoops;   //attached before run()
+
+            TimerWheel _wheel;          //looper thread only
+            int64_t _wheelDueNs = -1;   //when _uvWheel fires, -1 while stopped
+
+            //bounded mailbox, everything below is fixed once run() is called
+            size_t _capacity = 0;
+            OverflowPolicy _overflowPolicy = OverflowPolicy::BLOCK;
+            int64_t _blockTimeoutNs = 100000000LL;
+            std::vector<EventOverflow> _eventOverflow;     //indexed by EventId
+            std::atomic<size_t> _queued{ 0 };               //only counted when bounded
+            std::atomic<uint32_t> _roomEpoch{ 0 };
+            std::atomic<uint32_t> _roomWaiters{ 0 };
+            ShardedCounter _rejected;
+            ShardedCounter _droppedNewest;
+            ShardedCounter _droppedOldest;
+            ShardedCounter _blocked;
+            ShardedCounter _blockTimeouts;
+            int64_t _pollStartNs = 0;
+            std::atomic<int64_t> _idleNs{ 0 };
+            PollMode _pollMode = PollMode::SLEEP;
+            int64_t _maxSpinUs = 200;
+            bool _spinning = false;     //busy polling, stay awake for producers
 
-            std::atomic_uint64_t _eventFnSeq = 0;
             bool _forceStoped = false;
             bool _isStopped = false;
             bool _initialized = false;
 
             std::thread *_threadId = nullptr;
-            int64_t _intervalMs;
+            int64_t _intervalNs;
+            TickMode _tickMode = TickMode::UV_TIMER;
+            int64_t _tickSpinNs = 2000000LL;
+            OverrunPolicy _overrunPolicy = OverrunPolicy::CATCH_UP;
+            int _maxSteps = 5;
+            ThreadConfig _threadConfig;
 
         public:
             uv_loop_t * _uvLoop = nullptr;
             uv_async_t _uvAsync;
-            friend class LoopMgr;
+            uv_prepare_t _uvPrepare;
+            uv_check_t _uvCheck;
+            uv_idle_t _uvIdle;
+            uv_timer_t _uvWheel;
+            template<typename> friend class LoopMgr;
             friend void async_handle<LoopEvent>(uv_async_t * data);
+            friend void prepare_handle<LoopEvent>(uv_prepare_t * data);
+            friend void check_handle<LoopEvent>(uv_check_t * data);
+            friend void idle_handle<LoopEvent>(uv_idle_t * data);
+            friend void wheel_handle<LoopEvent>(uv_timer_t * data);
         };
 
 
@@ -120,8 +400,47 @@ namespace cocos2d
         template<typename LoopEvent>
         static void async_handle(uv_async_t *data)
         {
-            Looper<LoopEvent> *t = (Looper<LoopEvent> *)((char*)data - offsetof(Looper<LoopEvent>, _uvAsync));
-            t->onNotify();
+            Looper<LoopEvent> *t = (Looper<LoopEvent> *)data->data;
+            t->onNotify(true);
+        }
+
+        //mail left over by the drain budget, keeps poll from blocking until it is handled
+        template<typename LoopEvent>
+        static void idle_handle(uv_idle_t *data)
+        {
+            Looper<LoopEvent> *t = (Looper<LoopEvent> *)data->data;
+            t->onNotify(true);
+        }
+
+        //last chance before blocking in poll: drain what arrived while awake, then sleep
+        template<typename LoopEvent>
+        static void prepare_handle(uv_prepare_t *data)
+        {
+            Looper<LoopEvent> *t = (Looper<LoopEvent> *)data->data;
+            //while carrying over, the idle handle already took this iteration's slice
+            if (!t->_carrying) t->onNotify(true);
+            t->_pollStartNs = metricsNowNs();
+        }
+
+        //the wheel's uv timer is due
+        template<typename LoopEvent>
+        static void wheel_handle(uv_timer_t *data)
+        {
+            Looper<LoopEvent> *looper = static_cast<Looper<LoopEvent>*>(data->data);
+            looper->onWheelTimer();
+        }
+
+        //poll returned, timers and i/o callbacks are about to run
+        template<typename LoopEvent>
+        static void check_handle(uv_check_t *data)
+        {
+            Looper<LoopEvent> *t = (Looper<LoopEvent> *)data->data;
+            t->_awake.store(1);
+            if (t->_pollStartNs)
+            {
+                t->_idleNs.store(t->_idleNs.load(std::memory_order_relaxed) + metricsNowNs() - t->_pollStartNs, std::memory_order_relaxed);
+                t->_pollStartNs = 0;
+            }
         }
 
 
@@ -131,28 +450,37 @@ namespace cocos2d
 
         template<typename LoopEvent>
         Looper<LoopEvent>::Looper(ThreadCategory cate, Loop *tsk, int64_t updateMs) :
-            _category(cate), _loop(tsk), _intervalMs(updateMs)
+            _category(cate), _loop(tsk), _intervalNs(updateMs * 1000000LL)
         {}
 
         template<typename LoopEvent>
         Looper<LoopEvent>::Looper() :
-            _category(ThreadCategory::ANY_THREAD), _loop(nullptr), _intervalMs(1000)
+            _category(ThreadCategory::ANY_THREAD), _loop(nullptr), _intervalNs(1000000000LL)
         {}
 
         template<typename LoopEvent>
         Looper<LoopEvent>::Looper(Loop *tsk, int64_t updateMs) :
-            _category(ThreadCategory::ANY_THREAD), _loop(tsk), _intervalMs(updateMs)
+            _category(ThreadCategory::ANY_THREAD), _loop(tsk), _intervalNs(updateMs * 1000000LL)
         {}
 
         template<typename LoopEvent>
         Looper<LoopEvent>::~Looper()
         {
             if (_threadId) {
-                if (_threadId->joinable()) _threadId->join();
+                //the thread holds a reference too, the last one may be dropped by the thread itself
+                if (_threadId->get_id() == std::this_thread::get_id()) _threadId->detach();
+                else if (_threadId->joinable()) _threadId->join();
                 delete _threadId;
                 _threadId = nullptr;
             }
 
+            while (MailItem *item = popMail())
+            {
+                if (item->kind == MailItem::Kind::EVENT) delete static_cast<EventItem<LoopEvent>*>(item);
+                else if (item->kind == MailItem::Kind::CLOSURE) delete static_cast<ClosureItem<DispatchF>*>(item);
+                else if (item->kind == MailItem::Kind::CHANNEL) static_cast<ChannelItem*>(item)->deliver(nullptr, static_cast<ChannelItem*>(item));
+            }
+
             if (!_isStopped)
             {
                 std::cerr << "Destroy Looper and force close inner thread" << std::endl;
@@ -168,29 +496,65 @@ namespace cocos2d
             assert(!_initialized);
             _uvLoop = ThreadLoop::getThreadLoop();
             uv_async_init(_uvLoop, &_uvAsync, &async_handle<LoopEvent>);
-            _task = std::make_shared<LoopRunable>(_uvLoop, _loop, milliseconds(_intervalMs));
+            _uvAsync.data = this;
+            uv_prepare_init(_uvLoop, &_uvPrepare);
+            _uvPrepare.data = this;
+            uv_prepare_start(&_uvPrepare, &prepare_handle<LoopEvent>);
+            uv_unref((uv_handle_t*)&_uvPrepare);
+            uv_check_init(_uvLoop, &_uvCheck);
+            _uvCheck.data = this;
+            uv_check_start(&_uvCheck, &check_handle<LoopEvent>);
+            uv_unref((uv_handle_t*)&_uvCheck);
+            uv_idle_init(_uvLoop, &_uvIdle);
+            _uvIdle.data = this;
+            uv_timer_init(_uvLoop, &_uvWheel);
+            _uvWheel.data = this;
+            _task = std::make_shared<LoopRunable>(_uvLoop, _loop, nanoseconds(_intervalNs), _tickMode);
+            _task->setMaxSpin(nanoseconds(_tickSpinNs));
+            _task->setOverrunPolicy(_overrunPolicy, _maxSteps);
+            _task->setDriftHistogram(&_tickDrift);
+            for (auto &schedule : _pendingLoops) _task->attach(schedule);
+            _pendingLoops.clear();
+            _startNs = metricsNowNs();
             Looper::setLocalData("___thread", this);
+#ifdef CC_LOOP_COROUTINES
+            LooperResumer &resumer = LooperResumer::current();
+            resumer.looper = this;
+            resumer.post = &Looper::postExternalTo;
+#endif
             _initialized = true;
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::on(const std::string &name, Looper::EventCF callback)
+        void Looper<LoopEvent>::on(EventId id, Looper::EventCF callback)
         {
-            _callbackMap.add(name, callback);
+            assert(id.valid());
+            _callbackMap.add(id.index(), callback);
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::off(const std::string &name)
+        void Looper<LoopEvent>::off(EventId id)
         {
-            _callbackMap.clear(name);
+            _callbackMap.clear(id.index());
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::emit(const std::string &name, LoopEvent &event)
+        template<typename ...Args>
+        bool Looper<LoopEvent>::postEvent(EventId id, MailPriority prio, bool mayBlock, Args&&... args)
         {
             assert(_initialized);
-            _pendingEvents.pushBack(SeqItem<LoopEvent>(genSeq(), name, event));
+            OverflowPolicy policy = _overflowPolicy;
+            if (id.index() < _eventOverflow.size() && _eventOverflow[id.index()].set)
+            {
+                EventOverflow &ov = _eventOverflow[id.index()];
+                if (ov.lane) return pushLane(*ov.lane, LoopEvent(std::forward<Args>(args)...));
+                policy = ov.policy;
+            }
+            if (!admit(policy, mayBlock)) return false;
+            _emitted.add();
+            post(new EventItem<LoopEvent>(id, std::forward<Args>(args)...), prio);
             notify();
+            return true;
         }
 
         template<typename LoopEvent>
@@ -215,17 +579,26 @@ namespace cocos2d
 
             std::condition_variable cv;
             std::mutex mtx;
+            bool ready = false;
 
-            std::shared_ptr<Looper<LoopEvent> > self = shared_from_this();
+            std::shared_ptr<Looper<LoopEvent> > self = this->shared_from_this();
 
-            _threadId = new std::thread([self, &cv]() {
+            _threadId = new std::thread([self, &cv, &mtx, &ready]() {
+                if (!self->_threadConfig.apply())
+                {
+                    std::cerr << "Looper thread config partly failed to apply" << std::endl;
+                }
                 self->init();
+                {
+                    std::lock_guard<std::mutex> guard(mtx);
+                    ready = true;
+                }
                 cv.notify_all();
                 self->onRun();
             });
 
             std::unique_lock<std::mutex> lock(mtx);
-            cv.wait(lock);
+            cv.wait(lock, [&ready]() { return ready; });
         }
 
         template<typename LoopEvent>
@@ -238,14 +611,199 @@ namespace cocos2d
             Finalizer defer([tsk]() {
                 tsk->afterRun();
                 Looper<LoopEvent>::clearLocalData("___thread");
+#ifdef CC_LOOP_COROUTINES
+                LooperResumer::current() = LooperResumer();
+#endif
             });
             tsk->beforeRun();
 
             //handle events before thread start
             if (_isStopped) return;
-            onNotify();
+            onNotify(true);
             if (_isStopped) return;
-            tsk->run();
+            if (_pollMode == PollMode::BUSY_POLL)
+            {
+                pollLoop();
+            }
+            else
+            {
+                tsk->run();
+            }
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::setCapacity(size_t maxQueued, OverflowPolicy policy, milliseconds blockTimeout)
+        {
+            assert(!_threadId);
+            assert(policy != OverflowPolicy::DROP_OLDEST); //needs a ring per event, see setOverflowPolicy()
+            _capacity = maxQueued;
+            _overflowPolicy = policy;
+            _blockTimeoutNs = duration_cast<nanoseconds>(blockTimeout).count();
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::setOverflowPolicy(EventId id, OverflowPolicy policy, size_t ringSize)
+        {
+            assert(!_threadId && id.valid());
+            if (id.index() >= _eventOverflow.size()) _eventOverflow.resize(id.index() + 1);
+            EventOverflow &ov = _eventOverflow[id.index()];
+            ov.set = true;
+            ov.policy = policy;
+            ov.lane.reset(policy == OverflowPolicy::DROP_OLDEST ? new OldestLane(this, id, ringSize) : nullptr);
+        }
+
+        //reserves a mailbox slot for one event
+        template<typename LoopEvent>
+        bool Looper<LoopEvent>::admit(OverflowPolicy policy, bool mayBlock)
+        {
+            if (!_capacity) return true;
+            int64_t deadlineNs = 0;
+            while (true)
+            {
+                if (_queued.fetch_add(1) < _capacity) return true;
+                _queued.fetch_sub(1);
+                if (policy == OverflowPolicy::DROP_NEWEST) {
+                    _droppedNewest.add();
+                    return false;
+                }
+                if (policy == OverflowPolicy::FAIL || !mayBlock) {
+                    _rejected.add();
+                    return false;
+                }
+                if (isCurrentThread()) {
+                    //blocking on our own mailbox never ends, overfill instead
+                    _queued.fetch_add(1);
+                    return true;
+                }
+                if (!deadlineNs) {
+                    _blocked.add();
+                    deadlineNs = metricsNowNs() + _blockTimeoutNs;
+                }
+                if (!waitForRoom(deadlineNs)) {
+                    _blockTimeouts.add();
+                    return false;
+                }
+            }
+        }
+
+        //false once the deadline passed
+        template<typename LoopEvent>
+        bool Looper<LoopEvent>::waitForRoom(int64_t deadlineNs)
+        {
+            uint32_t epoch = _roomEpoch.load();
+            _roomWaiters.fetch_add(1);
+            //pairs with release(): either we see the room or it sees the waiter
+            bool full = _queued.load() >= _capacity;
+            int64_t leftNs = deadlineNs - metricsNowNs();
+            if (full && leftNs > 0) {
+                AtomicWait::wait(_roomEpoch, epoch, leftNs / 1000 > 0 ? leftNs / 1000 : 1);
+            }
+            _roomWaiters.fetch_sub(1);
+            return !full || metricsNowNs() < deadlineNs;
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::release(uint64_t n)
+        {
+            _queued.fetch_sub(n);
+            if (_roomWaiters.load() != 0) {
+                _roomEpoch.fetch_add(1);
+                AtomicWait::wakeAll(_roomEpoch);
+            }
+        }
+
+        template<typename LoopEvent>
+        template<typename E>
+        bool Looper<LoopEvent>::pushLane(OldestLane &lane, E &&event)
+        {
+            _emitted.add();
+            while (!lane.ring.tryPush(std::forward<E>(event)))
+            {
+                if (lane.ring.tryPop([](LoopEvent &) {})) _droppedOldest.add();
+            }
+            if (!lane.scheduled.exchange(true)) postExternal(&lane);
+            return true;
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::drainLane(OldestLane &lane)
+        {
+            //cleared first: a push after our last pop posts the lane again
+            lane.scheduled.exchange(false);
+            while (lane.ring.tryPop([this, &lane](LoopEvent &ev) {
+                _drainedItems.store(_drainedItems.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                handleEvent(lane.id, ev);
+            })) {}
+        }
+
+        template<typename LoopEvent>
+        size_t Looper<LoopEvent>::queued() const
+        {
+            if (_capacity) return _queued.load(std::memory_order_relaxed);
+            uint64_t handled = _drainedItems.load(std::memory_order_relaxed) + _droppedOldest.sum();
+            uint64_t posted = _emitted.sum() + _dispatched.sum() + _external.sum();
+            return posted > handled ? (size_t)(posted - handled) : 0;
+        }
+
+        template<typename LoopEvent>
+        typename Looper<LoopEvent>::OverflowStats Looper<LoopEvent>::getOverflowStats() const
+        {
+            OverflowStats st;
+            st.rejected = _rejected.sum();
+            st.droppedNewest = _droppedNewest.sum();
+            st.droppedOldest = _droppedOldest.sum();
+            st.blocked = _blocked.sum();
+            st.blockTimeouts = _blockTimeouts.sum();
+            return st;
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::setPollMode(PollMode mode, microseconds maxSpin)
+        {
+            assert(!_threadId);
+            _pollMode = mode;
+            _maxSpinUs = maxSpin.count() > 0 ? maxSpin.count() : 1;
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::pollLoop()
+        {
+            const int64_t minSpinUs = _maxSpinUs / 16 > 0 ? _maxSpinUs / 16 : 1;
+            int64_t spinUs = _maxSpinUs;
+            auto *tsk = _task.get();
+
+            while (!_isStopped)
+            {
+                //spin: producers see us awake and skip the wakeup syscall
+                _spinning = true;
+                _awake.store(1);
+                auto lastWork = high_resolution_clock::now();
+                while (true)
+                {
+                    uint64_t handled = _drainedItems.load(std::memory_order_relaxed);
+                    tsk->run(UV_RUN_NOWAIT);
+                    if (_isStopped) return;
+                    if (hasMail() || _forceStoped) onNotify(true);
+                    auto now = high_resolution_clock::now();
+                    if (_drainedItems.load(std::memory_order_relaxed) != handled) {
+                        lastWork = now;
+                    }
+                    else if (duration_cast<microseconds>(now - lastWork).count() >= spinUs) {
+                        break;
+                    }
+                    AtomicWait::pause();
+                }
+
+                //park: the prepare handle publishes the sleep state before poll blocks
+                _spinning = false;
+                auto parkStart = high_resolution_clock::now();
+                tsk->run(UV_RUN_ONCE);
+                int64_t parkedUs = duration_cast<microseconds>(high_resolution_clock::now() - parkStart).count();
+
+                //woken soon after parking: spinning longer would have caught it
+                if (parkedUs < spinUs * 2) spinUs = spinUs * 2 < _maxSpinUs ? spinUs * 2 : _maxSpinUs;
+                else spinUs = spinUs / 2 > minSpinUs ? spinUs / 2 : minSpinUs;
+            }
         }
 
         template<typename LoopEvent>
@@ -255,6 +813,90 @@ namespace cocos2d
             notify();
         }
 
+        template<typename LoopEvent>
+        template<typename T>
+        void Looper<LoopEvent>::on(const Channel<T> &ch, typename Channel<T>::Handler callback)
+        {
+            assert(ch.id().valid());
+            channelTable<T>().handlers.add(ch.id().index(), std::make_shared<typename Channel<T>::Handler>(std::move(callback)));
+        }
+
+        template<typename LoopEvent>
+        template<typename T>
+        void Looper<LoopEvent>::off(const Channel<T> &ch)
+        {
+            //no handler of this type ever, nothing to create a table for
+            ChannelTable<T> *table = findChannelTable<T>();
+            if (table) table->handlers.clear(ch.id().index());
+        }
+
+        //created on the first handler of a payload type, lives as long as the Looper
+        template<typename LoopEvent>
+        template<typename T>
+        ChannelTable<T> &Looper<LoopEvent>::channelTable()
+        {
+            std::lock_guard<std::mutex> guard(_channelMtx);
+            size_t idx = ChannelTypeIndex::of<T>();
+            const std::vector<ChannelTableBase*> *cur = _channelTables.load();
+            if (cur && idx < cur->size() && (*cur)[idx]) return static_cast<ChannelTable<T>&>(*(*cur)[idx]);
+
+            ChannelTable<T> *table = new ChannelTable<T>();
+            _channelOwned.emplace_back(table);
+            std::vector<ChannelTableBase*> *next = cur ? new std::vector<ChannelTableBase*>(*cur) : new std::vector<ChannelTableBase*>();
+            if (idx >= next->size()) next->resize(idx + 1, nullptr);
+            (*next)[idx] = table;
+            _channelSnapshots.emplace_back(next);
+            _channelTables.store(next);
+            return *table;
+        }
+
+        //any thread, snapshots are never freed while the Looper lives
+        template<typename LoopEvent>
+        template<typename T>
+        ChannelTable<T> *Looper<LoopEvent>::findChannelTable() const
+        {
+            const std::vector<ChannelTableBase*> *tables = _channelTables.load();
+            size_t idx = ChannelTypeIndex::of<T>();
+            if (!tables || idx >= tables->size()) return nullptr;
+            //the slot of a payload type only ever holds its own ChannelTable
+            return static_cast<ChannelTable<T>*>((*tables)[idx]);
+        }
+
+        template<typename LoopEvent>
+        template<typename T, typename ...Args>
+        bool Looper<LoopEvent>::postChannel(const Channel<T> &ch, MailPriority prio, bool mayBlock, Args&&... args)
+        {
+            assert(_initialized);
+            if (!admit(_overflowPolicy, mayBlock)) return false;
+            _emitted.add();
+            post(new ChannelPayload<T>(&Looper::deliverChannel<T>, ch.id(), std::forward<Args>(args)...), prio);
+            notify();
+            return true;
+        }
+
+        //the payload type comes from the instantiation, it picks the typed table of the handlers
+        template<typename LoopEvent>
+        template<typename T>
+        void Looper<LoopEvent>::deliverChannel(void *self, ChannelItem *item)
+        {
+            std::unique_ptr<ChannelPayload<T> > payload(static_cast<ChannelPayload<T>*>(item));
+            if (!self) return;
+            Looper *looper = static_cast<Looper*>(self);
+            ChannelTable<T> *table = looper->template findChannelTable<T>();
+            if (!table) return; //no handler of this type yet
+            CowIndexArray<typename ChannelTable<T>::HandlerPtr> &handlers = table->handlers;
+            T &data = payload->data;
+            auto call = [&data](const typename ChannelTable<T>::HandlerPtr &fn) { (*fn)(data); };
+            if (!looper->_timing.load(std::memory_order_relaxed))
+            {
+                handlers.forEach(payload->id.index(), call);
+                return;
+            }
+            int64_t start = metricsNowNs();
+            handlers.forEach(payload->id.index(), call);
+            looper->handlerTime(payload->id).record((uint64_t)(metricsNowNs() - start));
+        }
+
         template<typename LoopEvent>
         bool Looper<LoopEvent>::syncStop()
         {
@@ -294,95 +936,231 @@ namespace cocos2d
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::dispatch(Looper::DispatchF fn)
+        void Looper<LoopEvent>::dispatch(Looper::DispatchF fn, MailPriority prio)
         {
-            _pendingFns.pushBack(SeqItem<DispatchF>(genSeq(), fn));
+            _dispatched.add();
+            forceAdmit();
+            post(new ClosureItem<DispatchF>(std::move(fn)), prio);
             if (!isCurrentThread())
             {
                 notify();
             }
             else
             {
-                onNotify();
+                //a tick posting to its own looper must not flush a backlog the budget holds back
+                onNotify(true);
+            }
+        }
+
+        template<typename LoopEvent>
+        bool Looper<LoopEvent>::tryDispatch(Looper::DispatchF fn, MailPriority prio)
+        {
+            if (!admit(OverflowPolicy::FAIL, false)) return false;
+            _dispatched.add();
+            post(new ClosureItem<DispatchF>(std::move(fn)), prio);
+            if (!isCurrentThread())
+            {
+                notify();
+            }
+            else
+            {
+                onNotify(true);
             }
+            return true;
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::wait(Looper::DispatchF fn)
+        void Looper<LoopEvent>::wait(Looper::DispatchF fn, MailPriority prio)
         {
-            wait(fn, 0); //wait forever
+            wait(std::move(fn), 0, prio); //wait forever
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::wait(Looper::DispatchF fn, int timeoutMS)
+        void Looper<LoopEvent>::wait(Looper::DispatchF fn, int timeoutMS, MailPriority prio)
         {
             if (isCurrentThread())
             {
-                _pendingFns.pushBack(SeqItem<DispatchF>(genSeq(), fn));
+                _dispatched.add();
+                forceAdmit();
+                post(new ClosureItem<DispatchF>(std::move(fn)), prio);
                 onNotify();
             }
             else
             {
-                std::condition_variable cv;
-                std::mutex mtx;
-                std::unique_lock<std::mutex> lock(mtx);
-                _pendingFns.pushBack(SeqItem<DispatchF>(genSeq(), [&cv, &mtx, &fn]() {
-                    std::unique_lock<std::mutex> lock2(mtx);
-                    fn();
-                    cv.notify_one();
-                }));
-                notify();
+                //fn is owned by the posted task, a timed out caller leaves nothing dangling
+                Future<void> done = submit(std::move(fn), prio);
                 if (timeoutMS > 0)
                 {
-                    cv.wait_for(lock, milliseconds(timeoutMS));
+                    done.waitFor(milliseconds(timeoutMS));
                 }
                 else
                 {
-                    cv.wait(lock);
+                    done.wait();
                 }
             }
         }
 
+        template<typename LoopEvent>
+        template<typename F>
+        Future<typename FutureResult<void, F>::type> Looper<LoopEvent>::submit(F fn, MailPriority prio)
+        {
+            typedef typename FutureResult<void, F>::type R;
+            std::shared_ptr<FutureState<R> > state = std::make_shared<FutureState<R> >();
+            dispatch(FutureTask<R, F>(state, std::move(fn)), prio);
+            return Future<R>(state);
+        }
+
         template<typename LoopEvent>
         void Looper<LoopEvent>::notify()
         {
             if (_isStopped) return;
+            //pairs with the fence in onNotify(): either we see the looper asleep or it sees our item
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_awake.load(std::memory_order_relaxed) != 0) return;
+            if (_awake.exchange(1) != 0) return;
+            _wakeups.fetch_add(1, std::memory_order_relaxed);
             uv_async_send(&_uvAsync);
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::onNotify() {
+        void Looper<LoopEvent>::onNotify(bool budgeted) {
             assert(isCurrentThread());
 
             if (_isStopped) return;
 
-            while (_pendingEvents.size() > 0 && _pendingFns.size() > 0)
+            _notifyDepth += 1;
+            //a stop request flushes everything like before
+            budgeted = budgeted && _notifyDepth == 1 && !_forceStoped;
+            bool done = drainMailbox(budgeted);
+            if (_notifyDepth == 1) carryOver(!done);
+            if (_notifyDepth == 1 && !_spinning && done)
             {
-                auto ev = _pendingEvents.front();
-                auto fn = _pendingFns.front();
-                if (ev.id < fn.id) {
-                    SeqItem<LoopEvent> item = _pendingEvents.popFront();
-                    handleEvent(item.name, item.data);
+                //publish the sleep state, then catch producers that still saw us awake
+                while (true)
+                {
+                    _awake.store(0);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (!hasMail()) break;
+                    if (_awake.exchange(1) != 0) break; //a producer signalled, async will call back
+                    if (!drainMailbox(budgeted)) {
+                        carryOver(true);
+                        break;
+                    }
                 }
-                else {
-                    auto fn = _pendingFns.popFront();
-                    handleFn(fn.data);
+            }
+            _notifyDepth -= 1;
+
+            if (_forceStoped && !_isStopped) {
+                onStop();
+            }
+        }
+
+        //false when the budget ran out with mail left
+        template<typename LoopEvent>
+        bool Looper<LoopEvent>::drainMailbox(bool budgeted)
+        {
+            size_t maxItems = budgeted ? _budgetItems.load(std::memory_order_relaxed) : 0;
+            int64_t maxNs = budgeted ? _budgetNs.load(std::memory_order_relaxed) : 0;
+            int64_t deadlineNs = maxNs ? metricsNowNs() + maxNs : 0;
+            bool done = true;
+            size_t handled = 0;
+            while (true)
+            {
+                if ((maxItems && handled >= maxItems)
+                    || (deadlineNs && handled && handled % BUDGET_CLOCK_EVERY == 0 && metricsNowNs() >= deadlineNs))
+                {
+                    done = !hasMail();
+                    break;
                 }
+                MailItem *item = popMail();
+                if (!item) break;
+                handleCounted(item);
+                handled += 1;
             }
+            if (_unreleased)
+            {
+                release(_unreleased);
+                _unreleased = 0;
+            }
+            return done;
+        }
+
+        //the idle handle makes uv poll without blocking, so timers and i/o run before the rest
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::carryOver(bool left)
+        {
+            if (left) {
+                _carryOvers.store(_carryOvers.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                if (!_carrying) {
+                    _carrying = true;
+                    _awake.store(1); //not going to sleep, producers may skip the wakeup
+                    uv_idle_start(&_uvIdle, &idle_handle<LoopEvent>);
+                }
+            }
+            else if (_carrying) {
+                _carrying = false;
+                uv_idle_stop(&_uvIdle);
+            }
+        }
 
-            while (_pendingEvents.size() > 0)
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::setDrainBudget(size_t maxItems, microseconds maxTime)
+        {
+            _budgetItems.store(maxItems, std::memory_order_relaxed);
+            _budgetNs.store(duration_cast<nanoseconds>(maxTime).count(), std::memory_order_relaxed);
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::handleCounted(MailItem *item)
+        {
+            _drainedItems.store(_drainedItems.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (_capacity && ++_unreleased == RELEASE_BATCH)
             {
-                SeqItem<LoopEvent> item = _pendingEvents.popFront();
-                handleEvent(item.name, item.data);
+                release(_unreleased);
+                _unreleased = 0;
             }
-            while (_pendingFns.size() > 0)
+            handleItem(item);
+        }
+
+        template<typename LoopEvent>
+        typename Looper<LoopEvent>::DrainStats Looper<LoopEvent>::getDrainStats() const
+        {
+            DrainStats st;
+            st.drains = _drainCount.load(std::memory_order_relaxed);
+            st.items = _drainedItems.load(std::memory_order_relaxed);
+            st.maxBatch = _maxDrainBatch.load(std::memory_order_relaxed);
+            st.wakeups = _wakeups.load(std::memory_order_relaxed);
+            st.carryOvers = _carryOvers.load(std::memory_order_relaxed);
+            return st;
+        }
+
+        template<typename LoopEvent>
+        MetricsSnapshot Looper<LoopEvent>::snapshot()
+        {
+            MetricsSnapshot snap;
+            //handled first, so the depth does not go negative for items posted in between
+            snap.handled = _drainedItems.load(std::memory_order_relaxed);
+            uint64_t dropped = _droppedOldest.sum();
+            snap.emitted = _emitted.sum();
+            snap.dispatched = _dispatched.sum();
+            snap.external = _external.sum();
+            uint64_t posted = snap.emitted + snap.dispatched + snap.external;
+            snap.queueDepth = posted > snap.handled + dropped ? posted - snap.handled - dropped : 0;
+            snap.latency = _latency.snapshot();
+            snap.tickDrift = _tickDrift.snapshot();
             {
-                auto fn = _pendingFns.popFront();
-                handleFn(fn.data);
+                std::lock_guard<std::mutex> guard(_handlerTimeMtx);
+                for (auto &h : _handlerTime)
+                {
+                    if (h) snap.handlerTime.push_back(std::make_pair(h->id.name(), h->hist.snapshot()));
+                }
             }
-            if (_forceStoped && !_isStopped) {
-                onStop();
+            if (_startNs)
+            {
+                snap.uptimeNs = metricsNowNs() - _startNs;
+                snap.idleNs = _idleNs.load(std::memory_order_relaxed);
             }
+            return snap;
         }
 
         template<typename LoopEvent>
@@ -410,18 +1188,259 @@ namespace cocos2d
         }
 
         template<typename LoopEvent>
-        void Looper<LoopEvent>::handleEvent(const std::string &name, LoopEvent &ev)
+        void Looper<LoopEvent>::postExternal(ExternalItem *item, MailPriority prio)
+        {
+            _external.add();
+            forceAdmit();
+            post(item, prio);
+            notify();
+        }
+
+        template<typename LoopEvent>
+        inline void Looper<LoopEvent>::post(MailItem *item, MailPriority prio)
+        {
+            if (_timing.load(std::memory_order_relaxed)) item->postedNs = metricsNowNs();
+            if (prio == MailPriority::NORMAL) _mailbox.pushBack(item);
+            else if (prio == MailPriority::URGENT) _urgentBox.pushBack(item);
+            else _backgroundBox.pushBack(item);
+        }
+
+        template<typename LoopEvent>
+        MailItem *Looper<LoopEvent>::popFrom(MpscQueue<MailItem> &box, MpscBatch<MailItem> &batch)
+        {
+            if (batch.empty()) batch = box.takeAll();
+            return batch.popFront();
+        }
+
+        //the normal lane keeps the drain statistics
+        template<typename LoopEvent>
+        MailItem *Looper<LoopEvent>::popNormal()
+        {
+            if (_draining.empty())
+            {
+                _draining = _mailbox.takeAll();
+                if (_draining.empty()) return nullptr;
+                _drainCount.store(_drainCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                _drainingSize = 0;
+            }
+            MailItem *item = _draining.popFront();
+            _drainingSize += 1;
+            if (_draining.empty() && _drainingSize > _maxDrainBatch.load(std::memory_order_relaxed))
+            {
+                _maxDrainBatch.store(_drainingSize, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        //next item by priority, looper thread only
+        template<typename LoopEvent>
+        MailItem *Looper<LoopEvent>::popMail()
+        {
+            MailItem *item = nullptr;
+            if (++_sinceUrgentCheck >= URGENT_CHECK || !_urgentDraining.empty())
+            {
+                _sinceUrgentCheck = 0;
+                if ((item = popFrom(_urgentBox, _urgentDraining))) return item;
+            }
+            if (_sinceBackground >= BACKGROUND_EVERY)
+            {
+                //starvation guard, looks again after the next BACKGROUND_EVERY items either way
+                _sinceBackground = 0;
+                if ((item = popFrom(_backgroundBox, _backgroundDraining))) return item;
+            }
+            _sinceBackground += 1;
+            if ((item = popNormal())) return item;
+            if ((item = popFrom(_urgentBox, _urgentDraining))) return item;
+            _sinceBackground = 0;
+            return popFrom(_backgroundBox, _backgroundDraining);
+        }
+
+        template<typename LoopEvent>
+        bool Looper<LoopEvent>::hasMail() const
+        {
+            return !_draining.empty() || !_urgentDraining.empty() || !_backgroundDraining.empty()
+                || !_mailbox.empty() || !_urgentBox.empty() || !_backgroundBox.empty();
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::handleItem(MailItem *item)
         {
-            _callbackMap.forEach(name, [&ev](EventCF &eventCb) {
+            if (item->postedNs)
+            {
+                int64_t waited = metricsNowNs() - item->postedNs;
+                _latency.record(waited > 0 ? (uint64_t)waited : 0);
+                item->postedNs = 0; //external items get reposted
+            }
+            switch (item->kind)
+            {
+            case MailItem::Kind::EVENT:
+            {
+                std::unique_ptr<EventItem<LoopEvent> > ev(static_cast<EventItem<LoopEvent>*>(item));
+                handleEvent(ev->id, ev->data);
+                break;
+            }
+            case MailItem::Kind::CLOSURE:
+            {
+                std::unique_ptr<ClosureItem<DispatchF> > fn(static_cast<ClosureItem<DispatchF>*>(item));
+                handleFn(fn->fn);
+                break;
+            }
+            case MailItem::Kind::EXTERNAL:
+            {
+                ExternalItem *ext = static_cast<ExternalItem*>(item);
+                ext->run(ext);
+                break;
+            }
+            case MailItem::Kind::CHANNEL:
+            {
+                ChannelItem *ch = static_cast<ChannelItem*>(item);
+                ch->deliver(this, ch);
+                break;
+            }
+            }
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::handleEvent(EventId id, LoopEvent &ev)
+        {
+            if (!_timing.load(std::memory_order_relaxed))
+            {
+                _callbackMap.forEach(id.index(), [&ev](const EventCF &eventCb) {
+                    eventCb(ev);
+                });
+                return;
+            }
+            int64_t start = metricsNowNs();
+            _callbackMap.forEach(id.index(), [&ev](const EventCF &eventCb) {
                 eventCb(ev);
             });
+            handlerTime(id).record((uint64_t)(metricsNowNs() - start));
+        }
+
+        //looper thread only
+        template<typename LoopEvent>
+        LatencyHistogram &Looper<LoopEvent>::handlerTime(EventId id)
+        {
+            uint32_t idx = id.index();
+            if (idx < _handlerTime.size() && _handlerTime[idx]) return _handlerTime[idx]->hist;
+            std::lock_guard<std::mutex> guard(_handlerTimeMtx);
+            if (idx >= _handlerTime.size()) _handlerTime.resize(idx + 1);
+            _handlerTime[idx].reset(new HandlerTime());
+            _handlerTime[idx]->id = id;
+            return _handlerTime[idx]->hist;
         }
 
         template<typename LoopEvent>
-        inline void Looper<LoopEvent>::handleFn(const Looper::DispatchF &fn)
+        inline void Looper<LoopEvent>::handleFn(Looper::DispatchF &fn)
         {
             fn();
         }
 
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::attachLoop(Loop *loop, double intervalMs, double phaseMs, OverrunPolicy policy, int maxSteps)
+        {
+            LoopSchedule schedule;
+            schedule.task = loop;
+            schedule.intervalNs = (int64_t)(intervalMs * 1e6);
+            schedule.phaseNs = (int64_t)(phaseMs * 1e6);
+            schedule.policy = policy;
+            schedule.maxSteps = maxSteps;
+            if (!_threadId)
+            {
+                _pendingLoops.push_back(schedule);
+            }
+            else if (isCurrentThread())
+            {
+                _task->attach(schedule);
+            }
+            else
+            {
+                dispatch([this, schedule]() {
+                    _task->attach(schedule);
+                });
+            }
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::detachLoop(Loop *loop)
+        {
+            if (!_threadId)
+            {
+                for (auto it = _pendingLoops.begin(); it != _pendingLoops.end(); ++it)
+                {
+                    if (it->task == loop) {
+                        _pendingLoops.erase(it);
+                        return;
+                    }
+                }
+                return;
+            }
+            if (_isStopped) return;
+            wait([this, loop]() {
+                _task->detach(loop);
+            });
+        }
+
+        template<typename LoopEvent>
+        TimerHandle Looper<LoopEvent>::dispatchEvery(nanoseconds period, DispatchF fn)
+        {
+            assert(period.count() > 0);
+            return addTimer(metricsNowNs() + period.count(), period.count(), std::move(fn));
+        }
+
+        template<typename LoopEvent>
+        TimerHandle Looper<LoopEvent>::addTimer(int64_t deadlineNs, int64_t periodNs, DispatchF fn)
+        {
+            std::shared_ptr<TimerNode> node = std::make_shared<TimerNode>(deadlineNs, periodNs, std::move(fn));
+            if (isCurrentThread())
+            {
+                linkTimer(node);
+            }
+            else
+            {
+                //the wheel is looper thread only, cancel() before this runs just drops the node
+                dispatch([this, node]() {
+                    linkTimer(node);
+                }, MailPriority::URGENT);
+            }
+            return TimerHandle(node);
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::linkTimer(const std::shared_ptr<TimerNode> &node)
+        {
+            if (_isStopped || node->state.load() != TimerNode::PENDING) return;
+            //published here rather than in addTimer(), this is the looper thread
+            node->owner.store(std::this_thread::get_id());
+            _wheel.add(node);
+            if (_wheelDueNs < 0 || node->deadlineNs < _wheelDueNs) armWheel();
+        }
+
+        //one uv timer for the whole wheel, aimed at the next tick with work
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::armWheel()
+        {
+            int64_t now = metricsNowNs();
+            int64_t waitNs = _wheel.nextTimeoutNs(now);
+            if (waitNs < 0)
+            {
+                _wheelDueNs = -1;
+                uv_timer_stop(&_uvWheel);
+                return;
+            }
+            _wheelDueNs = now + waitNs;
+            uv_update_time(_uvLoop); //the timeout counts from uv_now, which is stale inside callbacks
+            uv_timer_start(&_uvWheel, &wheel_handle<LoopEvent>, (uint64_t)((waitNs + 999999) / 1000000), 0);
+        }
+
+        template<typename LoopEvent>
+        void Looper<LoopEvent>::onWheelTimer()
+        {
+            if (_isStopped) return;
+            _wheelDueNs = 0; //timers added by the callbacks leave the arming to the end
+            _wheel.advance(metricsNowNs());
+            armWheel();
+        }
+
     }
 }
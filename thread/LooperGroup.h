@@ -0,0 +1,373 @@
+#pragma once
+
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cassert>
+
+#include "Looper.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // pool of Loopers for closures that may run on any thread.
+        // every worker owns a deque: it pops its own work from the back and idle workers
+        // steal from the front of the others. Pinned work still goes straight to a
+        // worker's Looper mailbox through dispatch(index, fn).
+        // the pool grows while all workers are busy and the backlog is deep, and
+        // retires the last worker after it has been idle for idleTimeout.
+        template<typename LoopEvent>
+        class LooperGroup {
+        public:
+            typedef typename Looper<LoopEvent>::DispatchF DispatchF;
+            typedef std::shared_ptr<Looper<LoopEvent> > LooperPtr;
+
+            struct Options {
+                size_t minWorkers = 1;
+                size_t maxWorkers = 4;
+                size_t growBacklog = 32;     //queued tasks per busy worker before adding one
+                std::chrono::milliseconds idleTimeout{ 5000 };
+            };
+
+            explicit LooperGroup(const Options &opts);
+            ~LooperGroup();
+
+            void start();
+            void stop();
+
+            void dispatch(DispatchF fn);                //any worker
+            void dispatch(size_t worker, DispatchF fn); //pinned to one worker
+
+            size_t size() const { return _count.load(); }
+            size_t queued() const { return _queued.load(); }
+            LooperPtr getWorker(size_t idx);
+
+        private:
+            struct Worker;
+
+            struct PumpItem : ExternalItem {
+                PumpItem() : ExternalItem(&PumpItem::run) {}
+                static void run(ExternalItem *item)
+                {
+                    PumpItem *p = static_cast<PumpItem*>(item);
+                    p->group->pump(*p->worker);
+                }
+                LooperGroup *group = nullptr;
+                Worker *worker = nullptr;
+            };
+
+            //ticks on the worker thread to find idle workers
+            struct IdleCheck : Loop {
+                void update(int64_t dtUs) override { group->onIdleCheck(*worker); }
+                LooperGroup *group = nullptr;
+                Worker *worker = nullptr;
+            };
+
+            struct Worker {
+                LooperPtr looper;
+                std::mutex mtx;
+                std::deque<DispatchF> tasks;
+                bool retired = false;                   //guarded by mtx
+                std::atomic<bool> pumping{ false };     //stays set while retired, so nobody posts a pump
+                std::atomic<int64_t> idleSinceMs{ 0 };
+                PumpItem pumpItem;
+                IdleCheck idleCheck;
+            };
+
+            static const int PUMP_SLICE = 64;
+
+            void grow();
+            bool retire(Worker &w);
+            void wake(Worker &w);
+            void wakeIdle();
+            void pushTo(Worker &w, DispatchF &fn);
+            bool popLocal(Worker &w, DispatchF &out);
+            bool steal(Worker &self, DispatchF &out);
+            void pump(Worker &w);
+            void onIdleCheck(Worker &w);
+            static Worker *&currentWorker();
+            static int64_t nowMs();
+
+            Options _opts;
+            //maxWorkers, live ones are [0, _count). Retired workers stay allocated and are
+            //reused by grow(), so a racing pushTo() never sees a freed worker
+            std::vector<std::unique_ptr<Worker> > _slots;
+            std::atomic<size_t> _count{ 0 };
+            std::atomic<size_t> _queued{ 0 };
+            std::atomic<size_t> _active{ 0 };
+            std::atomic<size_t> _next{ 0 };
+            std::mutex _resizeMtx;
+            std::vector<LooperPtr> _retiredLoopers;         //guarded by _resizeMtx, joined later
+            bool _started = false;
+        };
+
+
+        template<typename LoopEvent>
+        LooperGroup<LoopEvent>::LooperGroup(const Options &opts) : _opts(opts)
+        {
+            if (_opts.maxWorkers < 1) _opts.maxWorkers = 1;
+            if (_opts.minWorkers < 1) _opts.minWorkers = 1;
+            if (_opts.minWorkers > _opts.maxWorkers) _opts.minWorkers = _opts.maxWorkers;
+            _slots.resize(_opts.maxWorkers);
+        }
+
+        template<typename LoopEvent>
+        LooperGroup<LoopEvent>::~LooperGroup()
+        {
+            stop();
+        }
+
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::start()
+        {
+            assert(!_started);
+            _started = true;
+            std::lock_guard<std::mutex> guard(_resizeMtx);
+            while (_count.load() < _opts.minWorkers) grow();
+        }
+
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::stop()
+        {
+            if (!_started) return;
+            _started = false;
+            std::lock_guard<std::mutex> guard(_resizeMtx);
+            size_t n = _count.exchange(0);
+            for (size_t i = 0; i < n; i++)
+            {
+                Worker &w = *_slots[i];
+                w.looper->syncStop();
+                w.looper->join();
+            }
+            for (auto &l : _retiredLoopers) l->join();
+            _retiredLoopers.clear();
+            _slots.clear();
+            _slots.resize(_opts.maxWorkers);
+        }
+
+        template<typename LoopEvent>
+        typename LooperGroup<LoopEvent>::LooperPtr LooperGroup<LoopEvent>::getWorker(size_t idx)
+        {
+            assert(idx < _count.load());
+            return _slots[idx]->looper;
+        }
+
+        //called with _resizeMtx held
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::grow()
+        {
+            size_t idx = _count.load();
+            if (idx >= _opts.maxWorkers) return;
+
+            for (auto &l : _retiredLoopers) l->join();
+            _retiredLoopers.clear();
+
+            if (!_slots[idx]) {
+                Worker *w = new Worker();
+                w->pumpItem.group = this;
+                w->pumpItem.worker = w;
+                w->idleCheck.group = this;
+                w->idleCheck.worker = w;
+                _slots[idx].reset(w);
+            }
+            Worker *w = _slots[idx].get();
+            w->idleSinceMs.store(nowMs());
+            int64_t checkMs = _opts.idleTimeout.count() / 2;
+            w->looper = std::make_shared<Looper<LoopEvent> >(ThreadCategory::ANY_THREAD, &w->idleCheck, checkMs > 0 ? checkMs : 1);
+            w->looper->run();
+            w->looper->wait([w]() {
+                currentWorker() = w;
+            });
+            {
+                std::lock_guard<std::mutex> guard(w->mtx);
+                w->retired = false;
+            }
+            w->pumping.store(false);
+            _count.store(idx + 1);
+        }
+
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::dispatch(DispatchF fn)
+        {
+            Worker *w = currentWorker();
+            size_t n = _count.load();
+            assert(n > 0);
+            if (!w || w->pumpItem.group != this) {
+                //not one of our workers, possibly one of another group
+                w = _slots[_next.fetch_add(1) % n].get();
+            }
+            pushTo(*w, fn);
+
+            if (_active.load() >= n && _queued.load() > n * _opts.growBacklog && n < _opts.maxWorkers)
+            {
+                std::unique_lock<std::mutex> lock(_resizeMtx, std::try_to_lock);
+                if (lock.owns_lock() && _started) grow();
+            }
+        }
+
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::dispatch(size_t worker, DispatchF fn)
+        {
+            assert(worker < _count.load());
+            _slots[worker]->looper->dispatch(std::move(fn));
+        }
+
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::pushTo(Worker &target, DispatchF &fn)
+        {
+            Worker *w = &target;
+            while (true)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(w->mtx);
+                    if (!w->retired) {
+                        w->tasks.push_back(std::move(fn));
+                        break;
+                    }
+                }
+                w = _slots[0].get(); //slot 0 is never retired
+            }
+            _queued.fetch_add(1);
+            wake(*w);
+            wakeIdle();
+        }
+
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::wake(Worker &w)
+        {
+            if (!w.pumping.exchange(true)) {
+                _active.fetch_add(1);
+                w.looper->postExternal(&w.pumpItem);
+            }
+        }
+
+        //queued work exceeds busy workers: let one idle worker come and steal
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::wakeIdle()
+        {
+            size_t n = _count.load();
+            if (_active.load() >= n || _queued.load() <= _active.load()) return;
+            for (size_t i = 0; i < n; i++)
+            {
+                Worker &w = *_slots[i];
+                if (!w.pumping.load()) {
+                    wake(w);
+                    return;
+                }
+            }
+        }
+
+        template<typename LoopEvent>
+        bool LooperGroup<LoopEvent>::popLocal(Worker &w, DispatchF &out)
+        {
+            std::lock_guard<std::mutex> guard(w.mtx);
+            if (w.tasks.empty()) return false;
+            out = std::move(w.tasks.back());
+            w.tasks.pop_back();
+            return true;
+        }
+
+        template<typename LoopEvent>
+        bool LooperGroup<LoopEvent>::steal(Worker &self, DispatchF &out)
+        {
+            size_t n = _count.load();
+            size_t start = _next.load();
+            for (size_t k = 0; k < n; k++)
+            {
+                Worker &victim = *_slots[(start + k) % n];
+                if (&victim == &self) continue;
+                std::lock_guard<std::mutex> guard(victim.mtx);
+                if (victim.tasks.empty()) continue;
+                out = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+            return false;
+        }
+
+        //runs on the worker thread from its mailbox
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::pump(Worker &w)
+        {
+            for (int i = 0; i < PUMP_SLICE; i++)
+            {
+                DispatchF task;
+                if (!popLocal(w, task) && !steal(w, task))
+                {
+                    w.idleSinceMs.store(nowMs());
+                    w.pumping.store(false);
+                    _active.fetch_sub(1);
+                    bool pending;
+                    {
+                        std::lock_guard<std::mutex> guard(w.mtx);
+                        pending = !w.tasks.empty();
+                    }
+                    if (pending) wake(w); //raced with a push that saw pumping == true
+                    return;
+                }
+                _queued.fetch_sub(1);
+                task();
+            }
+            //slice used up, give pinned work in the mailbox a turn before continuing
+            w.looper->postExternal(&w.pumpItem);
+        }
+
+        template<typename LoopEvent>
+        void LooperGroup<LoopEvent>::onIdleCheck(Worker &w)
+        {
+            size_t n = _count.load();
+            if (n <= _opts.minWorkers || &w != _slots[n - 1].get()) return;
+            if (w.pumping.load()) return;
+            if (nowMs() - w.idleSinceMs.load() < _opts.idleTimeout.count()) return;
+
+            std::unique_lock<std::mutex> lock(_resizeMtx, std::try_to_lock);
+            if (!lock.owns_lock() || !_started || _count.load() != n) return;
+            if (retire(w)) _count.store(n - 1);
+        }
+
+        //worker thread of w, _resizeMtx held
+        template<typename LoopEvent>
+        bool LooperGroup<LoopEvent>::retire(Worker &w)
+        {
+            if (w.pumping.exchange(true)) return false; //work arrived meanwhile
+            std::deque<DispatchF> left;
+            {
+                std::lock_guard<std::mutex> guard(w.mtx);
+                w.retired = true;
+                left.swap(w.tasks);
+            }
+            for (auto &fn : left)
+            {
+                _queued.fetch_sub(1);
+                pushTo(*_slots[0], fn);
+            }
+            _retiredLoopers.push_back(w.looper);
+            w.looper->asyncStop();
+            return true;
+        }
+
+        //worker owning the calling thread, null on other threads. Shared by every group of
+        //the same event type, check its group before using it
+        template<typename LoopEvent>
+        typename LooperGroup<LoopEvent>::Worker *&LooperGroup<LoopEvent>::currentWorker()
+        {
+            static thread_local Worker *worker = nullptr;
+            return worker;
+        }
+
+        template<typename LoopEvent>
+        int64_t LooperGroup<LoopEvent>::nowMs()
+        {
+            using namespace std::chrono;
+            return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+    }
+}
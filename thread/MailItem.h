@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "MpscQueue.h"
+#include "EventId.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+        // entry of the Looper mailbox, the queue order is the handle order
+        struct MailItem : MpscNode {
+            enum class Kind : uint8_t {
+                EVENT,
+                CLOSURE,
+                EXTERNAL,
+                CHANNEL,
+            };
+            explicit MailItem(Kind kind) : kind(kind) {}
+            Kind kind;
+            int64_t postedNs = 0;   //enqueue time, only stamped while Looper timing metrics are on
+        };
+
+        // entry whose storage is owned by the poster (e.g. an awaiter inside a coroutine
+        // frame), the Looper calls run() and never frees it
+        struct ExternalItem : MailItem {
+            typedef void(*RunF)(ExternalItem *item);
+            explicit ExternalItem(RunF run) : MailItem(Kind::EXTERNAL), run(run) {}
+            RunF run;
+        };
+
+        // payload of a typed Channel, see ChannelPayload. deliver() is instantiated per
+        // payload type by the Looper that posts it, it runs the handlers and frees the
+        // item, or only frees it when looper is null
+        struct ChannelItem : MailItem {
+            typedef void(*DeliverF)(void *looper, ChannelItem *item);
+            explicit ChannelItem(DeliverF deliver) : MailItem(Kind::CHANNEL), deliver(deliver) {}
+            DeliverF deliver;
+        };
+
+        template<typename T>
+        struct EventItem : MailItem {
+            template<typename ...Args>
+            EventItem(EventId id, Args&&... args) : MailItem(Kind::EVENT), id(id), data(std::forward<Args>(args)...) {}
+            EventId id;
+            T data;
+        };
+
+        template<typename F>
+        struct ClosureItem : MailItem {
+            ClosureItem(const F &fn) : MailItem(Kind::CLOSURE), fn(fn) {}
+            ClosureItem(F &&fn) : MailItem(Kind::CLOSURE), fn(std::move(fn)) {}
+            F fn;
+        };
+
+    }
+}
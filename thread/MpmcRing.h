@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <cassert>
+#include <new>
+#include <type_traits>
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // bounded multi-producer/multi-consumer ring (Vyukov), capacity is rounded up to
+        // a power of two. Every slot carries a sequence number, so tryPush()/tryPop()
+        // are one CAS on the position each and never block.
+        // values are constructed in the slot on push and moved out on pop, T only has to be
+        // move constructible.
+        template<typename T>
+        class MpmcRing {
+        public:
+            explicit MpmcRing(size_t capacity)
+            {
+                size_t size = 2;
+                while (size < capacity) size <<= 1;
+                _mask = size - 1;
+                _slots.reset(new Slot[size]);
+                for (size_t i = 0; i < size; i++) _slots[i].seq.store(i, std::memory_order_relaxed);
+            }
+            ~MpmcRing()
+            {
+                while (tryPop([](T &) {})) {}
+            }
+            MpmcRing(const MpmcRing &) = delete;
+            MpmcRing &operator=(const MpmcRing &) = delete;
+
+            size_t capacity() const { return _mask + 1; }
+
+            template<typename U>
+            bool tryPush(U &&value)
+            {
+                size_t pos = _tail.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    Slot &slot = _slots[pos & _mask];
+                    size_t seq = slot.seq.load(std::memory_order_acquire);
+                    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                    if (diff == 0) {
+                        if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            new (&slot.storage) T(std::forward<U>(value));
+                            slot.seq.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0) {
+                        return false; //full
+                    }
+                    else {
+                        pos = _tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            //fn gets the value after its slot was handed back to the producers
+            template<typename F>
+            bool tryPop(F &&fn)
+            {
+                size_t pos = _head.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    Slot &slot = _slots[pos & _mask];
+                    size_t seq = slot.seq.load(std::memory_order_acquire);
+                    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                    if (diff == 0) {
+                        if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            T value(std::move(*slot.ptr()));
+                            slot.ptr()->~T();
+                            slot.seq.store(pos + _mask + 1, std::memory_order_release);
+                            fn(value);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0) {
+                        return false; //empty
+                    }
+                    else {
+                        pos = _head.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+        private:
+            struct Slot {
+                std::atomic<size_t> seq{ 0 };
+                typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+                T *ptr() { return reinterpret_cast<T*>(&storage); }
+            };
+
+            std::unique_ptr<Slot[]> _slots;
+            size_t _mask = 0;
+            //padded instead of alignas: an over-aligned ring could not be new'd before C++17
+            char _pad0[64];
+            std::atomic<size_t> _tail{ 0 };
+            char _pad1[64];
+            std::atomic<size_t> _head{ 0 };
+            char _pad2[64];
+        };
+
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        struct MpscNode {
+            std::atomic<MpscNode*> next{ nullptr };
+        };
+
+        // detached run of MpscQueue nodes, owned by the consumer thread.
+        // links of the last pushed nodes may still be in flight when the batch is
+        // taken, popFront() waits for them (a producer is between two stores).
+        template<typename T>
+        class MpscBatch {
+        public:
+            MpscBatch() {}
+            MpscBatch(MpscNode *first, MpscNode *last) : _first(first), _last(last) {}
+
+            bool empty() const { return _first == nullptr; }
+
+            T *popFront()
+            {
+                MpscNode *node = _first;
+                if (!node) return nullptr;
+                if (node == _last) {
+                    _first = _last = nullptr;
+                }
+                else {
+                    _first = waitNext(node);
+                }
+                return static_cast<T*>(node);
+            }
+
+            static MpscNode *waitNext(MpscNode *node)
+            {
+                MpscNode *next;
+                while (!(next = node->next.load(std::memory_order_acquire)))
+                {
+                    std::this_thread::yield();
+                }
+                return next;
+            }
+
+        private:
+            MpscNode *_first = nullptr;
+            MpscNode *_last = nullptr;
+        };
+
+        // intrusive multi-producer/single-consumer queue.
+        // pushBack() is wait-free (one atomic exchange) and may be called from any thread,
+        // takeAll() detaches everything queued so far with one more exchange and must
+        // only be called from the single consumer thread.
+        // T must derive from MpscNode, ownership of nodes moves with them.
+        template<typename T>
+        class MpscQueue {
+        public:
+            MpscQueue() : _tail(&_stub) {}
+            MpscQueue(const MpscQueue &) = delete;
+            MpscQueue &operator=(const MpscQueue &) = delete;
+
+            void pushBack(T *ele)
+            {
+                ele->next.store(nullptr, std::memory_order_relaxed);
+                MpscNode *prev = _tail.exchange(ele, std::memory_order_acq_rel);
+                prev->next.store(ele, std::memory_order_release);
+            }
+
+            MpscBatch<T> takeAll()
+            {
+                MpscNode *first = _stub.next.load(std::memory_order_acquire);
+                if (!first) {
+                    if (_tail.load(std::memory_order_acquire) == &_stub) return MpscBatch<T>();
+                    first = MpscBatch<T>::waitNext(&_stub);
+                }
+                //nobody links to the stub again until it is the tail once more
+                _stub.next.store(nullptr, std::memory_order_relaxed);
+                MpscNode *last = _tail.exchange(&_stub, std::memory_order_acq_rel);
+                return MpscBatch<T>(first, last);
+            }
+
+            //consumer side only
+            bool empty() const
+            {
+                return _stub.next.load(std::memory_order_acquire) == nullptr
+                    && _tail.load(std::memory_order_acquire) == &_stub;
+            }
+
+        private:
+            MpscNode _stub;
+            //keep producers' cache line away from the consumer's. Padded instead of alignas,
+            //an over-aligned Looper could not be make_shared'd before C++17
+            char _pad0[64];
+            std::atomic<MpscNode*> _tail;
+            char _pad1[64];
+        };
+
+    }
+}
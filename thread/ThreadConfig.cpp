@@ -0,0 +1,85 @@
+#include "ThreadConfig.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cocos2d
+{
+    namespace loop
+    {
+#if defined(_WIN32)
+
+        bool ThreadConfig::apply() const
+        {
+            bool ok = true;
+            HANDLE self = GetCurrentThread();
+            if (!cpus.empty()) {
+                DWORD_PTR mask = 0;
+                for (int c : cpus) mask |= ((DWORD_PTR)1) << c;
+                ok = SetThreadAffinityMask(self, mask) != 0 && ok;
+            }
+            int prio = THREAD_PRIORITY_NORMAL;
+            if (realtime) prio = THREAD_PRIORITY_TIME_CRITICAL;
+            else if (nice <= -10) prio = THREAD_PRIORITY_HIGHEST;
+            else if (nice < 0) prio = THREAD_PRIORITY_ABOVE_NORMAL;
+            else if (nice >= 10) prio = THREAD_PRIORITY_LOWEST;
+            else if (nice > 0) prio = THREAD_PRIORITY_BELOW_NORMAL;
+            if (prio != THREAD_PRIORITY_NORMAL) {
+                ok = SetThreadPriority(self, prio) != 0 && ok;
+            }
+            //windows already prefers the ideal processor's node for new allocations
+            return ok;
+        }
+
+#elif defined(__linux__)
+
+#ifndef MPOL_LOCAL
+#define MPOL_LOCAL 4
+#endif
+
+        bool ThreadConfig::apply() const
+        {
+            bool ok = true;
+            pthread_t self = pthread_self();
+            if (!name.empty()) {
+                std::string n = name.substr(0, 15);
+                pthread_setname_np(self, n.c_str());
+            }
+            if (!cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int c : cpus) CPU_SET(c, &set);
+                ok = pthread_setaffinity_np(self, sizeof(set), &set) == 0 && ok;
+            }
+            if (realtime) {
+                sched_param param;
+                param.sched_priority = realtimePriority;
+                ok = pthread_setschedparam(self, SCHED_FIFO, &param) == 0 && ok;
+            }
+            else if (nice != 0) {
+                //per thread on linux when given the thread id
+                ok = setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice) == 0 && ok;
+            }
+            if (numaLocal) {
+                ok = syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) == 0 && ok;
+            }
+            return ok;
+        }
+
+#else
+
+        bool ThreadConfig::apply() const
+        {
+            return cpus.empty() && nice == 0 && !realtime && !numaLocal;
+        }
+
+#endif
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // scheduling setup applied by a Looper thread to itself before it starts.
+        // every part is best effort: apply() returns false if any requested part failed
+        // (e.g. SCHED_FIFO without the needed privileges), the rest still applies.
+        struct ThreadConfig {
+            std::string name;           //thread name shown by debuggers/top, max 15 chars on linux
+            std::vector<int> cpus;      //allowed cores, empty keeps the inherited mask
+            int nice = 0;               //-20..19, 0 keeps the default
+            bool realtime = false;      //SCHED_FIFO on linux, TIME_CRITICAL on win32
+            int realtimePriority = 1;   //1..99 with realtime
+            bool numaLocal = false;     //allocate from the node of the running cpu (linux)
+
+            bool apply() const;
+        };
+
+    }
+}
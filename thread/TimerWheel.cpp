@@ -0,0 +1,263 @@
+#include "TimerWheel.h"
+
+#include <cassert>
+
+#include "LoopMetrics.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        static int lowestBit(uint64_t v)
+        {
+#ifdef _MSC_VER
+            unsigned long idx;
+            _BitScanForward64(&idx, v);
+            return (int)idx;
+#else
+            return __builtin_ctzll(v);
+#endif
+        }
+
+        bool TimerHandle::cancel()
+        {
+            if (!_node) return false;
+            int expected = TimerNode::PENDING;
+            if (!_node->state.compare_exchange_strong(expected, TimerNode::CANCELLED)) return false;
+            if (std::this_thread::get_id() == _node->owner.load() && _node->wheel)
+            {
+                _node->wheel->remove(_node.get());
+            }
+            return true;
+        }
+
+        TimerWheel::TimerWheel(std::chrono::nanoseconds resolution) :
+            _resolutionNs(resolution.count() > 0 ? resolution.count() : 1), _baseNs(metricsNowNs())
+        {}
+
+        TimerWheel::~TimerWheel()
+        {
+            for (int l = 0; l < LEVELS; l++)
+            {
+                for (int s = 0; s < SLOTS; s++)
+                {
+                    TimerLink &head = _slots[l][s];
+                    while (head.next != &head)
+                    {
+                        TimerNode *node = static_cast<TimerNode*>(head.next);
+                        std::shared_ptr<TimerNode> hold = std::move(node->self);
+                        unlink(node);
+                        node->state.store(TimerNode::CANCELLED);
+                        node->fn = nullptr;
+                    }
+                }
+            }
+        }
+
+        int64_t TimerWheel::tickOf(int64_t deadlineNs) const
+        {
+            int64_t rel = deadlineNs - _baseNs;
+            return rel > 0 ? (rel + _resolutionNs - 1) / _resolutionNs : 0;
+        }
+
+        void TimerWheel::add(const std::shared_ptr<TimerNode> &node)
+        {
+            assert(!node->wheel);
+            if (_size == 0)
+            {
+                //nothing to expire in between, catch up so an idle wheel does not walk its backlog
+                int64_t now = (metricsNowNs() - _baseNs) / _resolutionNs;
+                if (now > _now) _now = now;
+            }
+            int64_t tick = tickOf(node->deadlineNs);
+            if (tick <= _now) tick = _now + 1; //the current tick is done, never fire early
+            node->self = node;
+            link(node.get(), tick);
+        }
+
+        void TimerWheel::remove(TimerNode *node)
+        {
+            if (node->wheel != this) return;
+            std::shared_ptr<TimerNode> hold = std::move(node->self);
+            unlink(node);
+            node->fn = nullptr; //release the captures now, the handle may live on
+        }
+
+        //tick may be the current one while cascading, it is expired right after
+        void TimerWheel::link(TimerNode *node, int64_t tick)
+        {
+            int64_t diff = tick - _now;
+            if (diff > MAX_SPAN) {
+                //parked in the last slot of the top level, relinked from the real deadline when it cascades
+                tick = _now + MAX_SPAN;
+                diff = MAX_SPAN;
+            }
+            int level = 0;
+            while (level < LEVELS - 1 && diff >= (1LL << (SLOT_BITS * (level + 1)))) level++;
+            int slot = (int)((tick >> (SLOT_BITS * level)) & SLOT_MASK);
+
+            TimerLink &head = _slots[level][slot];
+            node->prev = head.prev;
+            node->next = &head;
+            head.prev->next = node;
+            head.prev = node;
+            node->wheel = this;
+            node->level = level;
+            node->slot = slot;
+            _size += 1;
+            _levelSize[level] += 1;
+            if (level == 0) _occupied[slot / 64] |= 1ULL << (slot % 64);
+        }
+
+        void TimerWheel::unlink(TimerNode *node)
+        {
+            node->prev->next = node->next;
+            node->next->prev = node->prev;
+            node->prev = node;
+            node->next = node;
+            node->wheel = nullptr;
+            _size -= 1;
+            _levelSize[node->level] -= 1;
+            if (node->level == 0)
+            {
+                TimerLink &head = _slots[0][node->slot];
+                if (head.next == &head) _occupied[node->slot / 64] &= ~(1ULL << (node->slot % 64));
+            }
+        }
+
+        //the current slot of a level has come up, spread its timers over the levels below
+        void TimerWheel::cascade(int level)
+        {
+            TimerLink &head = _slots[level][(_now >> (SLOT_BITS * level)) & SLOT_MASK];
+            while (head.next != &head)
+            {
+                TimerNode *node = static_cast<TimerNode*>(head.next);
+                unlink(node);
+                int64_t tick = tickOf(node->deadlineNs);
+                link(node, tick < _now ? _now : tick);
+            }
+        }
+
+        size_t TimerWheel::expire(TimerLink &slot)
+        {
+            //detach the list first, callbacks may add timers to this very slot for the next turn
+            TimerLink due;
+            if (slot.next == &slot) return 0;
+            due.next = slot.next;
+            due.prev = slot.prev;
+            due.next->prev = &due;
+            due.prev->next = &due;
+            slot.next = &slot;
+            slot.prev = &slot;
+
+            size_t fired = 0;
+            while (due.next != &due)
+            {
+                TimerNode *node = static_cast<TimerNode*>(due.next);
+                std::shared_ptr<TimerNode> hold = std::move(node->self);
+                unlink(node);
+                if (node->periodNs == 0)
+                {
+                    int expected = TimerNode::PENDING;
+                    if (!node->state.compare_exchange_strong(expected, TimerNode::FIRED)) {
+                        node->fn = nullptr; //cancelled from another thread
+                        continue;
+                    }
+                    UniqueFunction<void()> fn = std::move(node->fn);
+                    fired += 1;
+                    fn();
+                    continue;
+                }
+                if (node->state.load() != TimerNode::PENDING) {
+                    node->fn = nullptr; //cancelled from another thread
+                    continue;
+                }
+                fired += 1;
+                node->fn();
+                if (node->state.load() != TimerNode::PENDING) {
+                    node->fn = nullptr;
+                    continue;
+                }
+                //fixed rate, periods missed while the thread was busy are skipped rather than replayed
+                int64_t nowNs = _baseNs + _now * _resolutionNs;
+                node->deadlineNs += node->periodNs;
+                if (node->deadlineNs <= nowNs)
+                {
+                    node->deadlineNs += ((nowNs - node->deadlineNs) / node->periodNs + 1) * node->periodNs;
+                }
+                add(hold);
+            }
+            return fired;
+        }
+
+        size_t TimerWheel::advance(int64_t nowNs)
+        {
+            int64_t target = (nowNs - _baseNs) / _resolutionNs;
+            size_t fired = 0;
+            while (_now < target)
+            {
+                if (_size == 0) {
+                    _now = target;
+                    break;
+                }
+                //jump over ticks with nothing to expire or cascade
+                int64_t step = ticksUntilWork();
+                if (_now + step > target) {
+                    _now = target;
+                    break;
+                }
+                _now += step;
+                for (int l = LEVELS - 1; l >= 1; l--)
+                {
+                    if ((_now & ((1LL << (SLOT_BITS * l)) - 1)) == 0) cascade(l);
+                }
+                fired += expire(_slots[0][_now & SLOT_MASK]);
+            }
+            return fired;
+        }
+
+        //ticks after _now to the next non empty level 0 slot or the next cascade of a non empty level
+        int64_t TimerWheel::ticksUntilWork() const
+        {
+            int64_t best = MAX_SPAN + 1;
+            if (_levelSize[0])
+            {
+                const int WORDS = SLOTS / 64;
+                int start = (int)((_now + 1) & SLOT_MASK);
+                for (int k = 0; k <= WORDS; k++)
+                {
+                    int word = (start / 64 + k) % WORDS;
+                    uint64_t bits = _occupied[word];
+                    if (k == 0) bits &= ~0ULL << (start % 64);
+                    else if (k == WORDS) bits &= (start % 64) ? ~(~0ULL << (start % 64)) : 0;
+                    if (!bits) continue;
+                    int slot = word * 64 + lowestBit(bits);
+                    best = ((slot - start) & SLOT_MASK) + 1;
+                    break;
+                }
+            }
+            for (int l = 1; l < LEVELS; l++)
+            {
+                if (!_levelSize[l]) continue;
+                int64_t span = 1LL << (SLOT_BITS * l);
+                int64_t toBoundary = span - (_now & (span - 1));
+                if (toBoundary < best) best = toBoundary;
+                break;
+            }
+            return best;
+        }
+
+        int64_t TimerWheel::nextTimeoutNs(int64_t nowNs) const
+        {
+            if (!_size) return -1;
+            int64_t dueNs = _baseNs + (_now + ticksUntilWork()) * _resolutionNs;
+            return dueNs > nowNs ? dueNs - nowNs : 0;
+        }
+
+    }
+}
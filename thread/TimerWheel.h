@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+#include "UniqueFunction.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        class TimerWheel;
+
+        struct TimerLink {
+            TimerLink *prev = this;
+            TimerLink *next = this;
+        };
+
+        struct TimerNode : TimerLink {
+            enum State { PENDING, FIRED, CANCELLED };
+
+            TimerNode(int64_t deadlineNs, int64_t periodNs, UniqueFunction<void()> fn) :
+                deadlineNs(deadlineNs), periodNs(periodNs), fn(std::move(fn)) {}
+
+            int64_t deadlineNs;
+            int64_t periodNs;                   //0 for one shot timers
+            UniqueFunction<void()> fn;
+            std::atomic<int> state{ PENDING };
+            std::atomic<std::thread::id> owner; //thread of the wheel, stored when the node is linked
+            //owner thread only
+            TimerWheel *wheel = nullptr;        //set while linked
+            int level = 0;
+            int slot = 0;
+            std::shared_ptr<TimerNode> self;    //the wheel's reference while linked
+        };
+
+        // returned by Looper::dispatchAfter()/dispatchAt()/dispatchEvery(), copyable,
+        // dropping it does not cancel the timer
+        class TimerHandle {
+        public:
+            TimerHandle() {}
+            explicit TimerHandle(std::shared_ptr<TimerNode> node) : _node(std::move(node)) {}
+
+            //false if it already fired (one shot) or was cancelled. On the looper thread the
+            //timer is unlinked at once, from other threads it is dropped when its slot comes up
+            bool cancel();
+            //not fired yet, or periodic and not cancelled
+            bool pending() const { return _node && _node->state.load() == TimerNode::PENDING; }
+            explicit operator bool() const { return (bool)_node; }
+
+        private:
+            std::shared_ptr<TimerNode> _node;
+        };
+
+        // hashed hierarchical timing wheel: LEVELS wheels of SLOTS slots, each level's slot
+        // spanning a whole turn of the level below. Timers are intrusive list nodes, so
+        // adding and removing is O(1); a timer moves down a level when its slot's turn comes,
+        // at most LEVELS - 1 times. Not thread safe, everything except TimerHandle::cancel()
+        // runs on the owner thread.
+        class TimerWheel {
+        public:
+            explicit TimerWheel(std::chrono::nanoseconds resolution = std::chrono::milliseconds(1));
+            ~TimerWheel();
+
+            //links a PENDING node, its deadline is rounded up to the next tick
+            void add(const std::shared_ptr<TimerNode> &node);
+            void remove(TimerNode *node);
+            //runs every timer due at nowNs, returns how many fired
+            size_t advance(int64_t nowNs);
+            //ns from nowNs until advance() has work, -1 when empty
+            int64_t nextTimeoutNs(int64_t nowNs) const;
+            size_t size() const { return _size; }
+
+        private:
+            static const int LEVELS = 4;
+            static const int SLOT_BITS = 8;
+            static const int SLOTS = 1 << SLOT_BITS;
+            static const int64_t SLOT_MASK = SLOTS - 1;
+            static const int64_t MAX_SPAN = (1LL << (SLOT_BITS * LEVELS)) - 1;
+
+            void link(TimerNode *node, int64_t tick);
+            void unlink(TimerNode *node);
+            void cascade(int level);
+            size_t expire(TimerLink &slot);
+            int64_t ticksUntilWork() const;
+            int64_t tickOf(int64_t deadlineNs) const;
+
+            int64_t _resolutionNs;
+            int64_t _baseNs;
+            int64_t _now = 0;           //last tick processed
+            size_t _size = 0;
+            size_t _levelSize[LEVELS] = {};
+            uint64_t _occupied[SLOTS / 64] = {};     //non empty level 0 slots
+            TimerLink _slots[LEVELS][SLOTS];
+        };
+
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <cassert>
+
+#include "Looper.h"
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        // latest value handoff from one writer thread to one reader Looper, e.g. the newest
+        // physics snapshot for the renderer. Three slots: the writer fills its back slot and
+        // publish() swaps it with the middle one, the reader swaps the middle one into its
+        // front slot. Both sides are one atomic exchange, the writer never waits and the
+        // reader sees a whole frame in place; versions the reader did not get to are skipped.
+        // The reader polls with fetch() (e.g. from Loop::update) or is woken through
+        // wakeOnPublish(). Destroy it after the reader Looper stopped.
+        template<typename T>
+        class TripleBuffer {
+        public:
+            typedef std::function<void(const T&)> ReadCF;
+
+            explicit TripleBuffer(const T &initial = T());
+            TripleBuffer(const TripleBuffer &) = delete;
+            TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+            //writer thread: fill the back slot, it still holds an older version
+            T &writeBuffer() { return _slots[_back]; }
+            void publish();
+
+            //reader thread: true when a newer version was swapped into read()
+            bool fetch();
+            const T &read() const { return _slots[_front]; }
+
+            //every publish schedules one fetch on the reader, publishes in between coalesce into it
+            template<typename LoopEvent>
+            void wakeOnPublish(std::shared_ptr<Looper<LoopEvent> > reader, ReadCF callback);
+
+            uint64_t published() const { return _published.load(std::memory_order_relaxed); }
+            uint64_t fetched() const { return _fetched.load(std::memory_order_relaxed); }   //published() - fetched() were skipped
+
+        private:
+            static const uint32_t DIRTY = 4;
+            static const uint32_t INDEX_MASK = 3;
+
+            struct WakeItem : ExternalItem {
+                WakeItem() : ExternalItem(&WakeItem::run) {}
+                static void run(ExternalItem *item)
+                {
+                    TripleBuffer *owner = static_cast<WakeItem*>(item)->owner;
+                    owner->_wakePending.store(false);
+                    if (owner->fetch()) owner->_onRead(owner->read());
+                }
+                TripleBuffer *owner = nullptr;
+            };
+
+            T _slots[3];
+            uint32_t _back = 0;                     //writer only
+            uint32_t _front = 1;                    //reader only
+            std::atomic<uint32_t> _middle{ 2 };     //slot index, DIRTY while unread
+            std::atomic<uint64_t> _published{ 0 };
+            std::atomic<uint64_t> _fetched{ 0 };
+
+            std::function<void(ExternalItem*)> _post;
+            ReadCF _onRead;
+            WakeItem _wake;
+            std::atomic<bool> _wakePending{ false };
+        };
+
+
+        template<typename T>
+        TripleBuffer<T>::TripleBuffer(const T &initial)
+        {
+            for (int i = 0; i < 3; i++) _slots[i] = initial;
+            _wake.owner = this;
+        }
+
+        template<typename T>
+        void TripleBuffer<T>::publish()
+        {
+            //release the back slot, take over whichever slot the reader left in the middle
+            uint32_t old = _middle.exchange(_back | DIRTY, std::memory_order_acq_rel);
+            _back = old & INDEX_MASK;
+            _published.store(_published.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (_post && !_wakePending.exchange(true)) _post(&_wake);
+        }
+
+        template<typename T>
+        bool TripleBuffer<T>::fetch()
+        {
+            if (!(_middle.load(std::memory_order_relaxed) & DIRTY)) return false;
+            uint32_t old = _middle.exchange(_front, std::memory_order_acq_rel);
+            _front = old & INDEX_MASK;
+            _fetched.store(_fetched.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        //call before the writer starts publishing
+        template<typename T>
+        template<typename LoopEvent>
+        void TripleBuffer<T>::wakeOnPublish(std::shared_ptr<Looper<LoopEvent> > reader, ReadCF callback)
+        {
+            assert(reader && callback);
+            _onRead = std::move(callback);
+            _post = [reader](ExternalItem *item) { reader->postExternal(item); };
+        }
+
+    }
+}
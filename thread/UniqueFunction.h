@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+
+#ifndef CC_LOOP_TASK_INLINE_SIZE
+#define CC_LOOP_TASK_INLINE_SIZE 48
+#endif
+
+namespace cocos2d
+{
+    namespace loop
+    {
+
+        template<typename Sig, size_t InlineSize = CC_LOOP_TASK_INLINE_SIZE>
+        class UniqueFunction;
+
+        // move-only replacement of std::function.
+        // callables up to InlineSize bytes (and nothrow movable) are stored in place,
+        // larger ones fall back to one heap allocation. Move-only captures are allowed.
+        template<typename R, typename ...Args, size_t InlineSize>
+        class UniqueFunction<R(Args...), InlineSize> {
+        public:
+            UniqueFunction() {}
+            UniqueFunction(std::nullptr_t) {}
+
+            template<typename F, typename = typename std::enable_if<
+                !std::is_same<typename std::decay<F>::type, UniqueFunction>::value>::type>
+            UniqueFunction(F &&fn)
+            {
+                typedef typename std::decay<F>::type Fn;
+                construct<Fn>(std::forward<F>(fn), std::integral_constant<bool, fitsInline<Fn>()>());
+            }
+
+            //nothrow, so callables capturing a UniqueFunction can still be stored inline
+            UniqueFunction(UniqueFunction &&o) noexcept { moveFrom(o); }
+
+            UniqueFunction &operator=(UniqueFunction &&o) noexcept
+            {
+                if (this != &o) {
+                    reset();
+                    moveFrom(o);
+                }
+                return *this;
+            }
+
+            UniqueFunction(const UniqueFunction &) = delete;
+            UniqueFunction &operator=(const UniqueFunction &) = delete;
+
+            ~UniqueFunction() { reset(); }
+
+            R operator()(Args... args)
+            {
+                assert(_ops);
+                return _ops->invoke(&_storage, std::forward<Args>(args)...);
+            }
+
+            explicit operator bool() const { return _ops != nullptr; }
+
+            void reset()
+            {
+                if (_ops) {
+                    _ops->destroy(&_storage);
+                    _ops = nullptr;
+                }
+            }
+
+            template<typename Fn>
+            static constexpr bool fitsInline()
+            {
+                return sizeof(Fn) <= InlineSize
+                    && alignof(Fn) <= alignof(Storage)
+                    && std::is_nothrow_move_constructible<Fn>::value;
+            }
+
+        private:
+            typedef typename std::aligned_storage<(InlineSize < sizeof(void*) ? sizeof(void*) : InlineSize)>::type Storage;
+
+            struct Ops {
+                R(*invoke)(void *, Args&&...);
+                void(*move)(void *dst, void *src); //move constructs dst and destroys src, never throws
+                void(*destroy)(void *);
+            };
+
+            template<typename Fn>
+            struct InlineOps {
+                static R invoke(void *p, Args&&... args) { return (*static_cast<Fn*>(p))(std::forward<Args>(args)...); }
+                static void move(void *dst, void *src)
+                {
+                    new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                    static_cast<Fn*>(src)->~Fn();
+                }
+                static void destroy(void *p) { static_cast<Fn*>(p)->~Fn(); }
+                static const Ops ops;
+            };
+
+            template<typename Fn>
+            struct HeapOps {
+                static R invoke(void *p, Args&&... args) { return (**static_cast<Fn**>(p))(std::forward<Args>(args)...); }
+                static void move(void *dst, void *src) { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); }
+                static void destroy(void *p) { delete *static_cast<Fn**>(p); }
+                static const Ops ops;
+            };
+
+            template<typename Fn, typename F>
+            void construct(F &&fn, std::true_type)
+            {
+                new (&_storage) Fn(std::forward<F>(fn));
+                _ops = &InlineOps<Fn>::ops;
+            }
+
+            template<typename Fn, typename F>
+            void construct(F &&fn, std::false_type)
+            {
+                *reinterpret_cast<Fn**>(&_storage) = new Fn(std::forward<F>(fn));
+                _ops = &HeapOps<Fn>::ops;
+            }
+
+            //inline callables are nothrow movable, heap ones move a pointer
+            void moveFrom(UniqueFunction &o) noexcept
+            {
+                if (o._ops) {
+                    o._ops->move(&_storage, &o._storage);
+                    _ops = o._ops;
+                    o._ops = nullptr;
+                }
+            }
+
+            Storage _storage;
+            const Ops *_ops = nullptr;
+        };
+
+        template<typename R, typename ...Args, size_t InlineSize>
+        template<typename Fn>
+        const typename UniqueFunction<R(Args...), InlineSize>::Ops UniqueFunction<R(Args...), InlineSize>::InlineOps<Fn>::ops = {
+            &InlineOps<Fn>::invoke, &InlineOps<Fn>::move, &InlineOps<Fn>::destroy
+        };
+
+        template<typename R, typename ...Args, size_t InlineSize>
+        template<typename Fn>
+        const typename UniqueFunction<R(Args...), InlineSize>::Ops UniqueFunction<R(Args...), InlineSize>::HeapOps<Fn>::ops = {
+            &HeapOps<Fn>::invoke, &HeapOps<Fn>::move, &HeapOps<Fn>::destroy
+        };
+
+    }
+}